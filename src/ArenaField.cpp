@@ -0,0 +1,35 @@
+#include "ArenaField.h"
+
+namespace barotropic_model {
+
+size_t ArenaField::
+numByte(const Mesh &mesh) {
+    return MemoryArena::alignedSize((mesh.numGrid(0, FULL)+2)*
+                                    mesh.numGrid(1, FULL)*sizeof(double),
+                                    MemoryArena::PAGE_SIZE);
+} // numByte
+
+void ArenaField::
+create(const Mesh &mesh, MemoryArena &arena) {
+    _mesh = &mesh;
+    is = mesh.is(FULL);
+    js = mesh.js(FULL);
+    numLon = mesh.numGrid(0, FULL)+2;
+    numLat = mesh.numGrid(1, FULL);
+    data = static_cast<double*>(arena.allocate(numByte(mesh), MemoryArena::PAGE_SIZE));
+    // First touch the rows by the threads that will compute on them, which
+    // are the rows between the Poles in the loops of the tendencies, while the
+    // Poles are computed serially.
+    #pragma omp parallel for
+    for (int j = 1; j < numLat-1; ++j) {
+        for (int i = 0; i < numLon; ++i) {
+            data[j*numLon+i] = 0.0;
+        }
+    }
+    for (int i = 0; i < numLon; ++i) {
+        data[i] = 0.0;
+        data[(numLat-1)*numLon+i] = 0.0;
+    }
+} // create
+
+} // barotropic_model
@@ -0,0 +1,51 @@
+#ifndef __ArenaField__
+#define __ArenaField__
+
+#include "MemoryArena.h"
+
+namespace barotropic_model {
+
+/**
+ *  This class is a single-level scalar field on the cell centers of a mesh,
+ *  whose storage is a block of a memory arena. It is used for the tendencies
+ *  and scratch buffers that are never input or output. The latitude rows are
+ *  contiguous (with one halo column on each side for the zonal periodic
+ *  boundary), and they are first-touched by the same OpenMP loop over the rows
+ *  between the Poles as the tendency loops (with the default schedule), so
+ *  each band of rows is placed on the NUMA node of the thread that works on
+ *  it.
+ */
+class ArenaField {
+    const Mesh *_mesh;
+    double *data;
+    int is, js;     //>! start indices of the cells (without halo)
+    int numLon;     //>! number of columns in one row (with halo)
+    int numLat;
+public:
+    ArenaField() : _mesh(NULL), data(NULL), is(0), js(0), numLon(0), numLat(0) {}
+
+    static size_t
+    numByte(const Mesh &mesh);
+
+    void
+    create(const Mesh &mesh, MemoryArena &arena);
+
+    const Mesh&
+    mesh() const {
+        return *_mesh;
+    }
+
+    double&
+    operator()(int i, int j) {
+        return data[(j-js)*numLon+i-is+1];
+    }
+
+    const double&
+    operator()(int i, int j) const {
+        return data[(j-js)*numLon+i-is+1];
+    }
+}; // ArenaField
+
+} // barotropic_model
+
+#endif // __ArenaField__
@@ -0,0 +1,244 @@
+#include "Autotuner.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace barotropic_model {
+
+static const char*
+hugePageModeName(MemoryArena::HugePageMode hugePageMode) {
+    switch (hugePageMode) {
+        case MemoryArena::TRANSPARENT_HUGE_PAGE:
+            return "thp";
+        case MemoryArena::EXPLICIT_HUGE_PAGE:
+            return "explicit";
+        default:
+            return "none";
+    }
+}
+
+Autotuner::Autotuner(const string &profileFileName) {
+    this->profileFileName = profileFileName;
+    numWarmupStep = 2;
+    numTrialStep = 10;
+    tolerance = 1.0e-10;
+    REPORT_ONLINE;
+}
+
+Autotuner::~Autotuner() {
+    REPORT_OFFLINE;
+}
+
+void Autotuner::
+setNumTrialStep(int numWarmupStep, int numTrialStep) {
+    if (numWarmupStep < 0 || numTrialStep < 1) {
+        REPORT_ERROR("Invalid trial step numbers!");
+    }
+    this->numWarmupStep = numWarmupStep;
+    this->numTrialStep = numTrialStep;
+} // setNumTrialStep
+
+Autotuner::Config Autotuner::
+tune(const string &variant, int numLon, int numLat, double dt,
+     const ModelFactory &createModel, const InitCond &initCond) {
+    if (variant.empty() || variant.find('\t') != string::npos) {
+        REPORT_ERROR("Invalid model variant \"" << variant << "\"!");
+    }
+    std::ostringstream key;
+    key << cpuModel() << "\t" << variant << "\t" << numLon << "\t" << numLat;
+    Config best;
+    if (readProfile(key.str(), best)) {
+        REPORT_NOTICE("Use the tuned profile in \"" << profileFileName << "\".");
+        return best;
+    }
+    // Collect the candidates.
+    vector<int> numThreads;
+    int maxNumThread = 1;
+#ifdef _OPENMP
+    maxNumThread = omp_get_max_threads();
+#endif
+    for (int n = 1; n < maxNumThread; n *= 2) {
+        numThreads.push_back(n);
+    }
+    numThreads.push_back(maxNumThread);
+    MemoryArena::HugePageMode hugePageModes[] = {
+        MemoryArena::NO_HUGE_PAGE, MemoryArena::TRANSPARENT_HUGE_PAGE
+    };
+    // The variants without the full memory mode only run in the lean one.
+    bool hasFullMemoryMode;
+    {
+        BarotropicModel_A_ImplicitMidpoint *model = createModel();
+        hasFullMemoryMode = model->hasFullMemoryMode();
+        delete model;
+    }
+    // Run the trials on one mesh shared by all the candidates.
+    Domain domain(2);
+    domain.radius() = 6.371e6;
+    Mesh mesh(domain);
+    mesh.init(numLon, numLat);
+    REPORT_NOTICE("Tune the execution knobs of " << variant << " model on " <<
+                  numLon << "x" << numLat << " mesh of " << cpuModel() << ".");
+    cout << setw(10) << "threads" << setw(8) << "lean" << setw(12) << "huge-pages" <<
+        setw(16) << "time/step (ms)" << endl;
+    best.stepTime = 0;
+    for (int i = 0; i < numThreads.size(); ++i) {
+        for (int lean = hasFullMemoryMode ? 0 : 1; lean < 2; ++lean) {
+            for (int k = 0; k < 2; ++k) {
+                Config config;
+                config.numThread = numThreads[i];
+                config.leanMemory = lean == 1;
+                config.hugePageMode = hugePageModes[k];
+                bool isPassed = runTrial(domain, mesh, dt, createModel,
+                                         initCond, config);
+                cout << setw(10) << config.numThread << setw(8) <<
+                    (config.leanMemory ? "yes" : "no") << setw(12) <<
+                    hugePageModeName(config.hugePageMode) << setw(16) <<
+                    fixed << setprecision(3) << config.stepTime*1.0e3;
+                if (!isPassed) cout << "  (drift beyond tolerance)";
+                cout << endl;
+                if (isPassed && (best.stepTime == 0 || config.stepTime < best.stepTime)) {
+                    best = config;
+                }
+            }
+        }
+    }
+#ifdef _OPENMP
+    omp_set_num_threads(maxNumThread);
+#endif
+    if (best.stepTime == 0) {
+        REPORT_ERROR("No configuration meets the conservation tolerance!");
+    }
+    REPORT_NOTICE("Choose " << best.numThread << " threads, lean memory " <<
+                  (best.leanMemory ? "on" : "off") << ", huge pages " <<
+                  hugePageModeName(best.hugePageMode) << ".");
+    writeProfile(key.str(), best);
+    return best;
+} // tune
+
+void Autotuner::
+apply(const Config &config, BarotropicModel_A_ImplicitMidpoint &model) {
+#ifdef _OPENMP
+    omp_set_num_threads(config.numThread);
+#endif
+    model.setLeanMemory(config.leanMemory);
+    model.setHugePageMode(config.hugePageMode);
+} // apply
+
+string Autotuner::
+cpuModel() {
+    std::ifstream file("/proc/cpuinfo");
+    string line;
+    while (std::getline(file, line)) {
+        if (line.compare(0, 10, "model name") == 0) {
+            string::size_type pos = line.find(':');
+            if (pos == string::npos) break;
+            string name = line.substr(line.find_first_not_of(" \t", pos+1));
+            std::replace(name.begin(), name.end(), '\t', ' ');
+            return name;
+        }
+    }
+    return "unknown";
+} // cpuModel
+
+bool Autotuner::
+readProfile(const string &key, Config &config) const {
+    std::ifstream file(profileFileName.c_str());
+    string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        // The key is the first four columns.
+        string::size_type pos = line.find('\t');
+        for (int k = 0; k < 3 && pos != string::npos; ++k) {
+            pos = line.find('\t', pos+1);
+        }
+        if (pos == string::npos || line.compare(0, pos, key) != 0) continue;
+        std::istringstream ss(line.substr(pos+1));
+        string lean, hugePage;
+        ss >> config.numThread >> lean >> hugePage >> config.stepTime;
+        if (!ss) {
+            REPORT_WARNING("Ignore the bad profile line \"" << line << "\"!");
+            continue;
+        }
+        config.leanMemory = lean == "yes";
+        if (hugePage == "thp") {
+            config.hugePageMode = MemoryArena::TRANSPARENT_HUGE_PAGE;
+        } else if (hugePage == "explicit") {
+            config.hugePageMode = MemoryArena::EXPLICIT_HUGE_PAGE;
+        } else {
+            config.hugePageMode = MemoryArena::NO_HUGE_PAGE;
+        }
+        return true;
+    }
+    return false;
+} // readProfile
+
+void Autotuner::
+writeProfile(const string &key, const Config &config) const {
+    // Keep the entries of the other machines and meshes.
+    vector<string> lines;
+    {
+        std::ifstream file(profileFileName.c_str());
+        string line;
+        while (std::getline(file, line)) {
+            if (line.compare(0, key.size()+1, key+"\t") != 0) {
+                lines.push_back(line);
+            }
+        }
+    }
+    if (lines.empty()) {
+        lines.push_back("# cpu-model\tvariant\tnumLon\tnumLat\tthreads\tlean\thuge-pages\tseconds-per-step");
+    }
+    std::ofstream file(profileFileName.c_str());
+    if (!file) {
+        REPORT_WARNING("Failed to write the tuned profile \"" <<
+                       profileFileName << "\"!");
+        return;
+    }
+    for (int i = 0; i < lines.size(); ++i) {
+        file << lines[i] << endl;
+    }
+    file << key << "\t" << config.numThread << "\t" <<
+        (config.leanMemory ? "yes" : "no") << "\t" <<
+        hugePageModeName(config.hugePageMode) << "\t" << config.stepTime << endl;
+} // writeProfile
+
+bool Autotuner::
+runTrial(Domain &domain, Mesh &mesh, double dt,
+         const ModelFactory &createModel, const InitCond &initCond,
+         Config &config) const {
+    typedef std::chrono::steady_clock Clock;
+    BarotropicModel_A_ImplicitMidpoint *model = createModel();
+    TimeManager timeManager;
+    ptime startTime(date(2000, 1, 1));
+    timeManager.init(startTime,
+                     startTime+seconds(int(dt)*(numWarmupStep+numTrialStep)),
+                     seconds(int(dt)));
+    // Note: The threads are set before the initialization, so the arena is
+    //       first-touched by the threads that will compute on it.
+    apply(config, *model);
+    model->setSharedMesh(domain, mesh);
+    model->setVerbose(false);
+    model->init(timeManager, mesh.numGrid(0, FULL), mesh.numGrid(1, FULL));
+    initCond(*model);
+    model->initialize();
+    if (numWarmupStep > 0) {
+        model->step(numWarmupStep);
+    }
+    // Note: The drift is taken after the warm-up, since the first step on
+    //       the reduced grid projects the initial condition onto it.
+    double e0 = model->totalEnergy();
+    double m0 = model->totalMass();
+    Clock::time_point t0 = Clock::now();
+    model->step(numTrialStep);
+    config.stepTime = std::chrono::duration<double>(Clock::now()-t0).count()/numTrialStep;
+    double energyDrift = fabs(model->totalEnergy()-e0)/e0;
+    double massDrift = fabs(model->totalMass()-m0)/m0;
+    delete model;
+    return energyDrift <= tolerance && massDrift <= tolerance;
+} // runTrial
+
+} // barotropic_model
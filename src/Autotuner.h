@@ -0,0 +1,95 @@
+#ifndef __Autotuner__
+#define __Autotuner__
+
+#include "BarotropicModel_A_ImplicitMidpoint.h"
+#include <functional>
+
+namespace barotropic_model {
+
+/**
+ *  This class tunes the execution knobs of the model at startup. It runs a
+ *  few trial steps of every candidate configuration on the actual mesh and
+ *  initial condition, drops the configurations whose total energy or mass
+ *  drifts beyond the tolerance, and picks the fastest one. The knobs are
+ *
+ *  - the number of OpenMP threads (powers of 2 up to the maximum),
+ *  - the memory-lean mode (unless the variant has no full memory mode),
+ *  - the huge page mode of the memory arena (none or transparent).
+ *
+ *  The trial models are created by the given factory, so they are the same
+ *  variant as the run (e.g. the semi-implicit model, the reduced grid or the
+ *  task graph), which is named by the caller. The result is cached in a
+ *  profile file keyed by the CPU model, the variant and the mesh size, so
+ *  later runs of the same variant on the same machine and mesh start tuned
+ *  without any trial. Each profile line has the tab-separated columns
+ *
+ *      cpu-model  variant  numLon  numLat  threads  lean  huge-pages  seconds-per-step
+ */
+class Autotuner {
+public:
+    struct Config {
+        int numThread;
+        bool leanMemory;
+        MemoryArena::HugePageMode hugePageMode;
+        double stepTime;    //>! measured wall time per step in seconds
+    };
+
+    typedef std::function<BarotropicModel_A_ImplicitMidpoint* ()> ModelFactory;
+    typedef std::function<void (BarotropicModel&)> InitCond;
+protected:
+    string profileFileName;
+    int numWarmupStep;
+    int numTrialStep;
+    double tolerance;       //>! relative energy and mass drift of the trial
+public:
+    Autotuner(const string &profileFileName);
+    virtual ~Autotuner();
+
+    void
+    setNumTrialStep(int numWarmupStep, int numTrialStep);
+
+    void
+    setTolerance(double tolerance) {
+        this->tolerance = tolerance;
+    }
+
+    /**
+     *  Return the tuned configuration for the given model variant and mesh,
+     *  from the profile if it has an entry for this CPU, variant and mesh, or
+     *  by the trials otherwise (and then store it into the profile). The
+     *  variant must not contain tabs, and the factory returns a new model of
+     *  the variant, which is configured except for the tuned knobs and not
+     *  initialized yet.
+     */
+    Config
+    tune(const string &variant, int numLon, int numLat, double dt,
+         const ModelFactory &createModel, const InitCond &initCond);
+
+    /**
+     *  Apply the configuration to the model and the OpenMP runtime. This must
+     *  be called before the model is initialized.
+     */
+    static void
+    apply(const Config &config, BarotropicModel_A_ImplicitMidpoint &model);
+
+    /**
+     *  Return the CPU model name of this machine.
+     */
+    static string
+    cpuModel();
+private:
+    bool
+    readProfile(const string &key, Config &config) const;
+
+    void
+    writeProfile(const string &key, const Config &config) const;
+
+    bool
+    runTrial(Domain &domain, Mesh &mesh, double dt,
+             const ModelFactory &createModel, const InitCond &initCond,
+             Config &config) const;
+}; // Autotuner
+
+} // barotropic_model
+
+#endif // __Autotuner__
@@ -0,0 +1,103 @@
+#include "BarotropicModel.h"
+#include "FieldExpression.h"
+
+namespace barotropic_model {
+
+void BarotropicModel::
+initialize() {
+    if (_mesh == NULL) {
+        REPORT_ERROR("Model must be initialized by init() first!");
+    }
+    BoundaryExchange::run(oldTimeIdx, {&u, &v, &gd});
+    BoundaryExchange::run({&ghs});
+} // initialize
+
+void BarotropicModel::
+step(int numStep) {
+    for (int n = 0; n < numStep; ++n) {
+        double dt = timeManager->stepSizeInSeconds();
+        // The surface geopotential may have been changed through its view.
+        if (ghsChanged) {
+            BoundaryExchange::run({&ghs});
+        }
+        integrate(oldTimeIdx, dt);
+        if (hasForcing) {
+            applyForcing(oldTimeIdx+1, dt);
+        }
+        timeManager->advance();
+        oldTimeIdx.shift();
+    }
+} // step
+
+BarotropicModel::StateView BarotropicModel::
+state() const {
+    StateView state = {
+        ConstFieldView(u, oldTimeIdx),
+        ConstFieldView(v, oldTimeIdx),
+        ConstFieldView(gd, oldTimeIdx)
+    };
+    return state;
+} // state
+
+FieldView BarotropicModel::
+surfaceGeopotentialView() {
+    ghsChanged = true;
+    return FieldView(ghs);
+} // surfaceGeopotentialView
+
+BarotropicModel::ForcingView BarotropicModel::
+forcing() {
+    if (!hasForcing) {
+        forcingU.create("fu", "m s-2", "zonal wind forcing", mesh(), CENTER, 2);
+        forcingV.create("fv", "m s-2", "meridional wind forcing", mesh(), CENTER, 2);
+        forcingGd.create("fgd", "m2 s-3", "geopotential depth forcing", mesh(), CENTER, 2);
+        level(forcingU) = 0.0;
+        level(forcingV) = 0.0;
+        level(forcingGd) = 0.0;
+        hasForcing = true;
+    }
+    ForcingView forcing = {
+        FieldView(forcingU), FieldView(forcingV), FieldView(forcingGd)
+    };
+    return forcing;
+} // forcing
+
+void BarotropicModel::
+setForcing(const double *forcingU, const double *forcingV,
+           const double *forcingGd) {
+    ForcingView view = forcing();
+    int numLon = view.gd.numLon(), numLat = view.gd.numLat();
+    for (int j = 0; j < numLat; ++j) {
+        for (int i = 0; i < numLon; ++i) {
+            if (forcingU != NULL) view.u(i, j) = forcingU[j*numLon+i];
+            if (forcingV != NULL) view.v(i, j) = forcingV[j*numLon+i];
+            if (forcingGd != NULL) view.gd(i, j) = forcingGd[j*numLon+i];
+        }
+    }
+} // setForcing
+
+void BarotropicModel::
+applyForcing(const TimeLevelIndex<2> &timeIdx, double dt) {
+    // Note: The forcing fields belong to the host code (see forcing()), so
+    //       the pole rows are handled here without changing them.
+    int js = mesh().js(FULL), jn = mesh().je(FULL);
+    double forcingGds = 0.0, forcingGdn = 0.0;
+    for (int i = mesh().is(FULL); i <= mesh().ie(FULL); ++i) {
+        forcingGds += forcingGd(i, js);
+        forcingGdn += forcingGd(i, jn);
+    }
+    forcingGds /= mesh().numGrid(0, FULL);
+    forcingGdn /= mesh().numGrid(0, FULL);
+    evaluateRegion(mesh().is(FULL), mesh().ie(FULL), js+1, jn-1,
+                   assign(level(u, timeIdx), level(u, timeIdx)+dt*level(forcingU)),
+                   assign(level(v, timeIdx), level(v, timeIdx)+dt*level(forcingV)),
+                   assign(level(gd, timeIdx), level(gd, timeIdx)+dt*level(forcingGd)));
+    for (int i = mesh().is(FULL); i <= mesh().ie(FULL); ++i) {
+        gd(timeIdx, i, js) += dt*forcingGds;
+        gd(timeIdx, i, jn) += dt*forcingGdn;
+    }
+    BoundaryExchange::applyRow(gd, timeIdx, js);
+    BoundaryExchange::applyRow(gd, timeIdx, jn);
+} // applyForcing
+
+} // barotropic_model
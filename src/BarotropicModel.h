@@ -2,6 +2,8 @@
 #define __BarotropicModel__
 
 #include "barotropic_model_commons.h"
+#include "PerfCounters.h"
+#include "FieldView.h"
 
 namespace barotropic_model {
 
@@ -26,8 +28,21 @@ namespace barotropic_model {
  *  where 𝛌, 𝜑 are the longitude and latitude, a is the sphere radius, 𝝓 is the
  *  geopotential depth, 𝝓ˢ is the surface geopotential, H = sqrt(𝝓), U = uH,
  *  V = vH, F = 2𝛀sin𝜑 + u/a tan𝜑.
+ *
+ *  Besides run(), which owns the whole time loop and writes the output files,
+ *  the model can be stepped by the host code of a coupled application through
+ *  initialize(), step(), state() and setForcing(), with zero-copy views of
+ *  the fields (see FieldView).
  */
 class BarotropicModel {
+public:
+    struct StateView {
+        ConstFieldView u, v, gd;
+    };
+
+    struct ForcingView {
+        FieldView u, v, gd;
+    };
 protected:
     Domain *_domain;
     Mesh *_mesh;
@@ -35,12 +50,21 @@ protected:
     IOManager io;
     Field<double, 2> u, v, gd;
     Field<double> ghs;
-    Field<double> dut, dvt, dgd;
     Field<double, 2> ut, vt, gdt;
-    Field<double> gdu, gdv;
+    Field<double> forcingU, forcingV, forcingGd;
+    bool hasForcing;
+    bool ghsChanged;        //>! since the terms derived from ghs were built
+    TimeLevelIndex<2> oldTimeIdx;
+    PerfCounters perf;
     bool firstRun;
 public:
-    BarotropicModel() { firstRun = true; }
+    BarotropicModel() {
+        _domain = NULL;
+        _mesh = NULL;
+        hasForcing = false;
+        ghsChanged = true;
+        firstRun = true;
+    }
     virtual ~BarotropicModel() {}
 
     virtual void
@@ -55,6 +79,62 @@ public:
     virtual void
     integrate(const TimeLevelIndex<2> &oldTimeIdx, double dt) = 0;
 
+    /**
+     *  Prepare the model for stepping by the host code, after init() and the
+     *  initial condition are set. No output file is written.
+     */
+    void
+    initialize();
+
+    /**
+     *  Advance the model by the given number of time steps.
+     */
+    void
+    step(int numStep = 1);
+
+    /**
+     *  Return the read-only views of the prognostic variables on the current
+     *  time level.
+     */
+    StateView
+    state() const;
+
+    /**
+     *  Return the index of the current time level, e.g. to access the
+     *  prognostic variables through zonalWind() and the like.
+     */
+    const TimeLevelIndex<2>&
+    currentTimeIdx() const {
+        return oldTimeIdx;
+    }
+
+    /**
+     *  Return the writable view of the surface geopotential. The changes take
+     *  effect from the next step, where the terms derived from it are
+     *  rebuilt.
+     */
+    FieldView
+    surfaceGeopotentialView();
+
+    /**
+     *  Return the writable views of the forcing tendencies of u, v and gd
+     *  (zero at first), which are added to the new time level after each
+     *  step. Forcing is turned on by the first call.
+     *
+     *  Note: The wind forcing on the Poles is ignored, and the forcing of the
+     *        geopotential depth on the Poles is replaced by its zonal mean.
+     */
+    ForcingView
+    forcing();
+
+    /**
+     *  Copy the forcing tendencies from the given arrays, which are ordered
+     *  by rows from the South Pole as the views. A null array is skipped.
+     */
+    void
+    setForcing(const double *forcingU, const double *forcingV,
+               const double *forcingGd);
+
     Domain&
     domain() const {
         return *_domain;
@@ -79,11 +159,26 @@ public:
     geopotentialDepth() {
         return gd;
     }
-    
+
+    /**
+     *  Return the surface geopotential, e.g. to set the initial condition.
+     *
+     *  Note: Changes after the first step must be made through
+     *        surfaceGeopotentialView(), so that they are not missed by the
+     *        terms derived from it.
+     */
     Field<double>&
     surfaceGeopotential() {
         return ghs;
     }
+
+    PerfCounters&
+    perfCounters() {
+        return perf;
+    }
+protected:
+    void
+    applyForcing(const TimeLevelIndex<2> &timeIdx, double dt);
 }; // BarotropicModel
 
 } // barotropic_model
@@ -1,82 +1,437 @@
 #include "BarotropicModel_A_ImplicitMidpoint.h"
+#include "NestedRefinement.h"
+#include "ForcingStream.h"
 
 namespace barotropic_model {
 
+/**
+ *  The tendency kernels read the half-level state through the following
+ *  accessors, which average the old and new levels on the fly, so the half
+ *  level is never stored. FullState reads the stored transformed variables
+ *  and the cached differences of the surface geopotential, and LeanState
+ *  derives them from u, v, gd and ghs on the fly.
+ *
+ *  The new winds and geopotential depth may be read from different time
+ *  levels, since the first iteration starts by reading the old level as the
+ *  new one instead of copying it.
+ */
+class FullState {
+    const Field<double, 2> &_u, &_v, &_gd, &_ut, &_vt, &_gdt;
+    const ArenaField &_ghsDx, &_ghsDy;
+    const TimeLevelIndex<2> &oldTimeIdx, &windTimeIdx, &gdTimeIdx;
+public:
+    FullState(const Field<double, 2> &u, const Field<double, 2> &v,
+              const Field<double, 2> &gd, const Field<double, 2> &ut,
+              const Field<double, 2> &vt, const Field<double, 2> &gdt,
+              const ArenaField &ghsDx, const ArenaField &ghsDy,
+              const TimeLevelIndex<2> &oldTimeIdx,
+              const TimeLevelIndex<2> &windTimeIdx,
+              const TimeLevelIndex<2> &gdTimeIdx)
+    : _u(u), _v(v), _gd(gd), _ut(ut), _vt(vt), _gdt(gdt), _ghsDx(ghsDx),
+      _ghsDy(ghsDy), oldTimeIdx(oldTimeIdx), windTimeIdx(windTimeIdx),
+      gdTimeIdx(gdTimeIdx) {}
+
+    double u(int i, int j) const {
+        return (_u(oldTimeIdx, i, j)+_u(windTimeIdx, i, j))*0.5;
+    }
+
+    double v(int i, int j) const {
+        return (_v(oldTimeIdx, i, j)+_v(windTimeIdx, i, j))*0.5;
+    }
+
+    double gd(int i, int j) const {
+        return (_gd(oldTimeIdx, i, j)+_gd(gdTimeIdx, i, j))*0.5;
+    }
+
+    double ut(int i, int j) const {
+        return (_ut(oldTimeIdx, i, j)+_ut(windTimeIdx, i, j))*0.5;
+    }
+
+    double vt(int i, int j) const {
+        return (_vt(oldTimeIdx, i, j)+_vt(windTimeIdx, i, j))*0.5;
+    }
+
+    double gdt(int i, int j) const {
+        return (_gdt(oldTimeIdx, i, j)+_gdt(gdTimeIdx, i, j))*0.5;
+    }
+
+    // Note: The cached zonal differences already span the block of the row
+    //       (see buildSurfaceGeopotentialCache()), so the block size is not
+    //       needed here.
+    double ghsDx(int i, int j, int) const {
+        return _ghsDx(i, j);
+    }
+
+    double ghsDy(int i, int j) const {
+        return _ghsDy(i, j);
+    }
+}; // FullState
+
+class LeanState {
+    const Field<double, 2> &_u, &_v, &_gd;
+    const Field<double> &_ghs;
+    const TimeLevelIndex<2> &oldTimeIdx, &windTimeIdx, &gdTimeIdx;
+public:
+    LeanState(const Field<double, 2> &u, const Field<double, 2> &v,
+              const Field<double, 2> &gd, const Field<double> &ghs,
+              const TimeLevelIndex<2> &oldTimeIdx,
+              const TimeLevelIndex<2> &windTimeIdx,
+              const TimeLevelIndex<2> &gdTimeIdx)
+    : _u(u), _v(v), _gd(gd), _ghs(ghs), oldTimeIdx(oldTimeIdx),
+      windTimeIdx(windTimeIdx), gdTimeIdx(gdTimeIdx) {}
+
+    double u(int i, int j) const {
+        return (_u(oldTimeIdx, i, j)+_u(windTimeIdx, i, j))*0.5;
+    }
+
+    double v(int i, int j) const {
+        return (_v(oldTimeIdx, i, j)+_v(windTimeIdx, i, j))*0.5;
+    }
+
+    double gd(int i, int j) const {
+        return (_gd(oldTimeIdx, i, j)+_gd(gdTimeIdx, i, j))*0.5;
+    }
+
+    double ut(int i, int j) const {
+        return (_u(oldTimeIdx, i, j)*sqrt(_gd(oldTimeIdx, i, j))+
+                _u(windTimeIdx, i, j)*sqrt(_gd(windTimeIdx, i, j)))*0.5;
+    }
+
+    double vt(int i, int j) const {
+        return (_v(oldTimeIdx, i, j)*sqrt(_gd(oldTimeIdx, i, j))+
+                _v(windTimeIdx, i, j)*sqrt(_gd(windTimeIdx, i, j)))*0.5;
+    }
+
+    double gdt(int i, int j) const {
+        return (sqrt(_gd(oldTimeIdx, i, j))+sqrt(_gd(gdTimeIdx, i, j)))*0.5;
+    }
+
+    double ghsDx(int i, int j, int r) const {
+        return _ghs(i+r, j)-_ghs(i-1, j);
+    }
+
+    double ghsDy(int i, int j) const {
+        return _ghs(i, j+1)-_ghs(i, j-1);
+    }
+}; // LeanState
+
+/**
+ *  Replace the cells of one block on a reduced row by their mean, unless
+ *  they are equal already, so that the projection is idempotent. Return
+ *  whether the cells are changed.
+ */
+template <class Terminal>
+bool
+averageBlock(const Terminal &field, int i, int j, int r) {
+    bool isConstant = true;
+    double mean = 0.0;
+    for (int k = 0; k < r; ++k) {
+        mean += field(i+k, j);
+        isConstant = isConstant && field(i+k, j) == field(i, j);
+    }
+    if (isConstant) return false;
+    mean /= r;
+    for (int k = 0; k < r; ++k) {
+        field.at(i+k, j) = mean;
+    }
+    return true;
+} // averageBlock
+
 BarotropicModel_A_ImplicitMidpoint::BarotropicModel_A_ImplicitMidpoint() {
+    leanMemory = false;
+    hugePageMode = MemoryArena::NO_HUGE_PAGE;
+    reducedGrid = false;
+    maxIteration = 8;
+    _numIteration = 0;
+    verbose = true;
+    numPyramidLevel = 0;
+    fieldOutput = true;
+    outputPrefix = "output";
+    outputFileIdx = -1;
+    streamDecimation = 1;
+    numTaskThread = 0;
+    taskBandSize = 4;
+    regionIs = regionIe = regionJs = regionJe = 0;
+    nest = NULL;
+    forcingStream = NULL;
+    taskPool = NULL;
+    graphDt = 0;
+    sharedDomain = NULL;
+    sharedMesh = NULL;
     REPORT_ONLINE;
 }
 
 BarotropicModel_A_ImplicitMidpoint::~BarotropicModel_A_ImplicitMidpoint() {
+    if (taskPool != NULL) {
+        delete taskPool;
+    }
     REPORT_OFFLINE;
 }
 
+void BarotropicModel_A_ImplicitMidpoint::
+setLeanMemory(bool leanMemory) {
+    if (_mesh != NULL) {
+        REPORT_ERROR("Memory-lean mode must be set before initialization!");
+    }
+    this->leanMemory = leanMemory;
+} // setLeanMemory
+
+void BarotropicModel_A_ImplicitMidpoint::
+setHugePageMode(MemoryArena::HugePageMode hugePageMode) {
+    if (_mesh != NULL) {
+        REPORT_ERROR("Huge page mode must be set before initialization!");
+    }
+    this->hugePageMode = hugePageMode;
+} // setHugePageMode
+
+void BarotropicModel_A_ImplicitMidpoint::
+setReducedGrid(bool reducedGrid) {
+    if (_mesh != NULL) {
+        REPORT_ERROR("Reduced grid must be set before initialization!");
+    }
+    this->reducedGrid = reducedGrid;
+} // setReducedGrid
+
+void BarotropicModel_A_ImplicitMidpoint::
+setMaxIteration(int maxIteration) {
+    if (maxIteration < 1) {
+        REPORT_ERROR("Maximum iteration number must be positive!");
+    }
+    this->maxIteration = maxIteration;
+} // setMaxIteration
+
+void BarotropicModel_A_ImplicitMidpoint::
+setTaskGraph(int numThread, int bandSize) {
+    if (_mesh != NULL) {
+        REPORT_ERROR("Task graph must be set before initialization!");
+    }
+    if (numThread < 0 || bandSize < 1) {
+        REPORT_ERROR("Task graph needs non-negative thread number and " <<
+                     "positive band size!");
+    }
+    numTaskThread = numThread;
+    taskBandSize = bandSize;
+} // setTaskGraph
+
+void BarotropicModel_A_ImplicitMidpoint::
+setPyramidOutput(int numPyramidLevel) {
+    if (numPyramidLevel < 0) {
+        REPORT_ERROR("Number of pyramid levels must not be negative!");
+    }
+    this->numPyramidLevel = numPyramidLevel;
+} // setPyramidOutput
+
+void BarotropicModel_A_ImplicitMidpoint::
+setSharedMesh(Domain &domain, Mesh &mesh) {
+    if (_mesh != NULL) {
+        REPORT_ERROR("Shared mesh must be set before initialization!");
+    }
+    sharedDomain = &domain;
+    sharedMesh = &mesh;
+} // setSharedMesh
+
+void BarotropicModel_A_ImplicitMidpoint::
+setRegion(int is, int ie, int js, int je) {
+    if (_mesh == NULL) {
+        REPORT_ERROR("Region must be set after initialization!");
+    }
+    if (reducedGrid || numTaskThread > 0) {
+        REPORT_ERROR("Region is not supported in the reduced-grid or " <<
+                     "task-graph mode!");
+    }
+    if (is > ie || js > je || is <= mesh().is(FULL) || ie >= mesh().ie(FULL) ||
+        js <= mesh().js(FULL)+1 || je >= mesh().je(FULL)-1) {
+        REPORT_ERROR("Region (" << is << ":" << ie << ", " << js << ":" <<
+                     je << ") touches the Poles or the zonal boundary!");
+    }
+    regionIs = is; regionIe = ie;
+    regionJs = js; regionJe = je;
+    // Rebuild the cached terms on the rows of the region.
+    ghsChanged = true;
+    estimateStageFlops();
+} // setRegion
+
 void BarotropicModel_A_ImplicitMidpoint::
 init(TimeManager &timeManager, int numLon, int numLat) {
     this->timeManager = &timeManager;
     // Initialize the IO manager.
     io.init(timeManager);
-    // Initialize the domain.
-    _domain = new Domain(2);
-    domain().radius() = 6.371e6;
-    // Initialize the mesh.
-    _mesh = new Mesh(domain());
-    mesh().init(numLon, numLat);
+    if (sharedMesh == NULL) {
+        // Initialize the domain.
+        _domain = new Domain(2);
+        domain().radius() = 6.371e6;
+        // Initialize the mesh.
+        _mesh = new Mesh(domain());
+        mesh().init(numLon, numLat);
+    } else if (sharedMesh->numGrid(0, FULL) != numLon ||
+               sharedMesh->numGrid(1, FULL) != numLat) {
+        REPORT_ERROR("Shared mesh size does not match " << numLon << "x" <<
+                     numLat << "!");
+    } else {
+        _domain = sharedDomain;
+        _mesh = sharedMesh;
+    }
+    regionIs = mesh().is(FULL); regionIe = mesh().ie(FULL);
+    regionJs = mesh().js(FULL); regionJe = mesh().je(FULL);
     dlon = mesh().gridInterval(0, FULL, 0);
     dlat = mesh().gridInterval(1, FULL, 0); // Assume the equidistance grids.
     // Create the variables.
-    u.create("u", "m s-1", "zonal wind speed", mesh(), CENTER, 2, HAS_HALF_LEVEL);
-    v.create("v", "m s-1", "meridional wind speed", mesh(), CENTER, 2, HAS_HALF_LEVEL);
-    gd.create("gd", "m2 s-2", "geopotential depth", mesh(), CENTER, 2, HAS_HALF_LEVEL);
+    // Note: The half time level is computed on the fly, so it is not stored.
+    u.create("u", "m s-1", "zonal wind speed", mesh(), CENTER, 2);
+    v.create("v", "m s-1", "meridional wind speed", mesh(), CENTER, 2);
+    gd.create("gd", "m2 s-2", "geopotential depth", mesh(), CENTER, 2);
+    if (!leanMemory) {
+        ut.create("ut", "(m s-1)*m-2", "transformed zonal wind speed", mesh(), CENTER, 2);
+        vt.create("vt", "(m s-1)*m-2", "transformed meridional wind speed", mesh(), CENTER, 2);
+        gdt.create("gdt", "m-2", "transformed geopotential height", mesh(), CENTER, 2);
+    }
     ghs.create("ghs", "m2 s-2", "surface geopotential", mesh(), CENTER, 2);
-    ut.create("ut", "(m s-1)*m-2", "transformed zonal wind speed", mesh(), CENTER, 2, HAS_HALF_LEVEL);
-    vt.create("vt", "(m s-1)*m-2", "transformed meridional wind speed", mesh(), CENTER, 2, HAS_HALF_LEVEL);
-    gdt.create("gdt", "m-2", "transformed geopotential height", mesh(), CENTER, 2, HAS_HALF_LEVEL);
-    dut.create("dut", "m s-2", "zonal wind speed tendency", mesh(), CENTER, 2);
-    dvt.create("dvt", "m s-2", "meridional zonal speed tendency", mesh(), CENTER, 2);
-    dgd.create("dgd", "m-2 s-1", "geopotential depth tendency", mesh(), CENTER, 2);
-    gdu.create("gdu", "m2 s-1", "ut * gdt", mesh(), CENTER, 2);
-    gdv.create("gdv", "m2 s-1", "vt * gdt", mesh(), CENTER, 2);
-    fu.create("fu", "* m s-1", "* * u", mesh(), CENTER, 2);
-    fv.create("fv", "* m s-1", "* * v", mesh(), CENTER, 2);
+    // Allocate the tendencies, scratch buffers and coefficients from the arena.
+    int numCoef = mesh().numGrid(1, FULL);
+    int numArenaField = 5+(numTaskThread > 0 ? 4 : 0)+
+                        (hasSurfaceGeopotentialCache() ? 2 : 0);
+    arena.init(numArenaField*ArenaField::numByte(mesh())+
+               10*MemoryArena::alignedSize(numCoef*sizeof(double)), hugePageMode);
+    dut.create(mesh(), arena);
+    dvt.create(mesh(), arena);
+    dgd.create(mesh(), arena);
+    fu.create(mesh(), arena);
+    fv.create(mesh(), arena);
+    if (numTaskThread > 0) {
+        fuZonal.create(mesh(), arena);
+        fvZonal.create(mesh(), arena);
+        fuMeridional.create(mesh(), arena);
+        fvMeridional.create(mesh(), arena);
+        taskPool = new ThreadPool(numTaskThread);
+    }
+    if (hasSurfaceGeopotentialCache()) {
+        ghsDx.create(mesh(), arena);
+        ghsDy.create(mesh(), arena);
+    }
+    cosLat = arena.allocate<double>(numCoef);
+    tanLat = arena.allocate<double>(numCoef);
+    factorCor = arena.allocate<double>(numCoef);
+    factorCur = arena.allocate<double>(numCoef);
+    factorLon = arena.allocate<double>(numCoef);
+    factorLat = arena.allocate<double>(numCoef);
+    factorLatCos = arena.allocate<double>(numCoef);
+    rowSum = arena.allocate<double>(numCoef);
+    reduceFactor = arena.allocate<int>(numCoef);
+    blockWeight = arena.allocate<double>(numCoef);
+    // First touch the coefficients by the rows of the tendency loops as the
+    // arena fields, and then set them.
+    #pragma omp parallel for
+    for (int j = mesh().js(FULL)+1; j <= mesh().je(FULL)-1; ++j) {
+        cosLat[j] = tanLat[j] = factorCor[j] = factorCur[j] = 0.0;
+        factorLon[j] = factorLat[j] = factorLatCos[j] = rowSum[j] = 0.0;
+        reduceFactor[j] = 1; blockWeight[j] = 1.0;
+    }
     // Set some coefficients.
     // Note: Some coefficients containing cos(lat) will be specialized at Poles.
-    cosLat.set_size(mesh().numGrid(1, FULL));
     for (int j = mesh().js(FULL)+1; j <= mesh().je(FULL)-1; ++j) {
         cosLat[j] = mesh().cosLat(FULL, j);
     }
     cosLat[mesh().js(FULL)] = mesh().cosLat(HALF, mesh().js(HALF))*0.25;
     cosLat[mesh().je(FULL)] = mesh().cosLat(HALF, mesh().je(HALF))*0.25;
-    tanLat.set_size(mesh().numGrid(1, FULL));
     for (int j = mesh().js(FULL)+1; j <= mesh().je(FULL)-1; ++j) {
         tanLat[j] = mesh().tanLat(FULL, j);
     }
     tanLat[mesh().js(FULL)] = -1/cosLat[mesh().js(FULL)];
     tanLat[mesh().je(FULL)] =  1/cosLat[mesh().je(FULL)];
-    factorCor.set_size(mesh().numGrid(1, FULL));
     for (int j = mesh().js(FULL); j <= mesh().je(FULL); ++j) {
         factorCor[j] = 2*OMEGA*mesh().sinLat(FULL, j);
     }
-    factorCur.set_size(mesh().numGrid(1, FULL));
     for (int j = mesh().js(FULL); j <= mesh().je(FULL); ++j) {
         factorCur[j] = tanLat[j]/domain().radius();
     }
-    factorLon.set_size(mesh().numGrid(1, FULL));
+    // Merge the cells on the high-latitude rows by powers of 2, so that the
+    // zonal grid interval is not less than half of the one on the Equator.
+    // Note: The Poles are zonal means already.
+    for (int j = mesh().js(FULL); j <= mesh().je(FULL); ++j) {
+        reduceFactor[j] = 1;
+        if (!reducedGrid || j == mesh().js(FULL) || j == mesh().je(FULL)) {
+            continue;
+        }
+        while (numLon%(reduceFactor[j]*2) == 0 &&
+               reduceFactor[j]*2*mesh().cosLat(FULL, j) <= 1) {
+            reduceFactor[j] *= 2;
+        }
+    }
     for (int j = mesh().js(FULL); j <= mesh().je(FULL); ++j) {
-        factorLon[j] = 1/(2*dlon*domain().radius()*cosLat[j]);
+        blockWeight[j] = 1.0/reduceFactor[j];
+    }
+    // Note: The zonal differences span the blocks on the reduced rows.
+    for (int j = mesh().js(FULL); j <= mesh().je(FULL); ++j) {
+        factorLon[j] = 1/(2*dlon*domain().radius()*cosLat[j])*blockWeight[j];
     }
-    factorLat.set_size(mesh().numGrid(1, FULL));
     for (int j = mesh().js(FULL); j <= mesh().je(FULL); ++j) {
         factorLat[j] = 1/(2*dlat*domain().radius()*cosLat[j]);
     }
+    for (int j = mesh().js(FULL); j <= mesh().je(FULL); ++j) {
+        factorLatCos[j] = factorLat[j]*cosLat[j]*blockWeight[j];
+    }
     // Set the variables on the Poles.
     for (int i = mesh().is(FULL)-1; i <= mesh().ie(FULL)+1; ++i) {
         dut(i, mesh().js(FULL)) = 0.0; dut(i, mesh().je(FULL)) = 0.0;
         dvt(i, mesh().js(FULL)) = 0.0; dvt(i, mesh().je(FULL)) = 0.0;
-        gdu(i, mesh().js(FULL)) = 0.0; gdu(i, mesh().je(FULL)) = 0.0;
-        gdv(i, mesh().js(FULL)) = 0.0; gdv(i, mesh().je(FULL)) = 0.0;
+        fu(i, mesh().js(FULL)) = 0.0; fu(i, mesh().je(FULL)) = 0.0;
+        fv(i, mesh().js(FULL)) = 0.0; fv(i, mesh().je(FULL)) = 0.0;
+        if (numTaskThread > 0) {
+            int js = mesh().js(FULL), je = mesh().je(FULL);
+            fuZonal(i, js) = 0.0; fuZonal(i, je) = 0.0;
+            fvZonal(i, js) = 0.0; fvZonal(i, je) = 0.0;
+            fuMeridional(i, js) = 0.0; fuMeridional(i, je) = 0.0;
+            fvMeridional(i, js) = 0.0; fvMeridional(i, je) = 0.0;
+        }
     }
+    // Register the stages for the performance counters.
+    perf.addStage("transform");
+    perf.addStage("geopotential depth tendency");
+    perf.addStage("geopotential depth update");
+    perf.addStage("zonal wind tendency");
+    perf.addStage("meridional wind tendency");
+    perf.addStage("wind update");
+    perf.addStage("diagnostics");
+    estimateStageFlops();
 } // init
 
+/**
+ *  The FLOPs of a cell are counted from the kernels of the normal rows, where
+ *  the half level accessors of the states take 2 FLOPs (4 or 6 with the
+ *  square roots of the memory-lean mode) and a square root or a division is
+ *  taken as 1 FLOP. The blocks of the reduced rows are counted as the cells
+ *  of the normal rows, and the Poles, the cache of the surface geopotential
+ *  and the total mass are left out, so the estimates are rough but follow the
+ *  kernels that are actually run.
+ */
+void BarotropicModel_A_ImplicitMidpoint::
+estimateStageFlops() {
+    int numLon = regionIe-regionIs+1;
+    double numCell = double(numLon)*(regionJe-regionJs+1);
+    double numTendencyCell = double(numLon)*(tendencyJe()-tendencyJs()+1);
+    double numFluxCell = double(numLon+2)*(fluxJe()-fluxJs()+1);
+    double numRingCell = double(numLon+2)*(ringJe()-ringJs()+1);
+    // FLOPs of the fluxes and tendencies on one cell.
+    double gdFlux, windFlux, windTendency;
+    if (leanMemory) {
+        gdFlux = 19; windFlux = 13; windTendency = 67;
+    } else {
+        gdFlux = 9; windFlux = 9; windTendency = 44;
+    }
+    perf.setStageFlops(PERF_TRANSFORM, leanMemory ? 0 :
+                       3*numRingCell*(isRegional() ? 2 : 1));
+    perf.setStageFlops(PERF_GEOPOTENTIAL_DEPTH_TENDENCY,
+                       gdFlux*numFluxCell+5*numTendencyCell);
+    perf.setStageFlops(PERF_GEOPOTENTIAL_DEPTH_UPDATE,
+                       (leanMemory ? 2 : 3)*numCell);
+    perf.setStageFlops(PERF_ZONAL_WIND_TENDENCY,
+                       windFlux*numFluxCell+windTendency*numTendencyCell);
+    perf.setStageFlops(PERF_MERIDIONAL_WIND_TENDENCY,
+                       windFlux*numFluxCell+windTendency*numTendencyCell);
+    perf.setStageFlops(PERF_WIND_UPDATE, (leanMemory ? 12 : 6)*numCell);
+    perf.setStageFlops(PERF_DIAGNOSTICS, 9*numCell);
+} // estimateStageFlops
+
 void BarotropicModel_A_ImplicitMidpoint::
 input(const string &fileName) {
     int fileIdx = io.addInputFile(mesh(), fileName);
@@ -88,120 +443,271 @@ input(const string &fileName) {
     io.input<double>(fileIdx, {&ghs});
     io.close(fileIdx);
     io.removeFile(fileIdx);
-    u.applyBndCond(oldTimeIdx);
-    v.applyBndCond(oldTimeIdx);
-    gd.applyBndCond(oldTimeIdx);
-    ghs.applyBndCond();
+    BoundaryExchange::run(oldTimeIdx, {&u, &v, &gd});
+    BoundaryExchange::run({&ghs});
+    ghsChanged = true;
 } // input
 
 void BarotropicModel_A_ImplicitMidpoint::
 run() {
-    // Add the output fields.
-    StampString filePattern("output.%5s.nc");
-    int fileIdx = io.addOutputFile(mesh(), filePattern, hours(1));
-    io.file(fileIdx).addField("double", FULL_DIMENSION, {&u, &v, &gd});
-    io.file(fileIdx).addField("double", FULL_DIMENSION, {&ghs});
+    // The fields of the nested refinement are written by its own model with
+    // the same time stamps.
+    int nestFileIdx = -1;
+    if (nest != NULL && fieldOutput) {
+        BarotropicModel_A_ImplicitMidpoint &child = nest->childModel();
+        StampString nestFilePattern(outputPrefix+".nest.%5s.nc");
+        nestFileIdx = child.io.addOutputFile(child.mesh(), nestFilePattern, hours(1));
+        child.io.file(nestFileIdx).addField("double", FULL_DIMENSION,
+                                            {&child.u, &child.v, &child.gd});
+        child.io.file(nestFileIdx).addField("double", FULL_DIMENSION, {&child.ghs});
+    }
+    auto outputNest = [&] () {
+        if (nestFileIdx < 0) return;
+        BarotropicModel_A_ImplicitMidpoint &child = nest->childModel();
+        child.io.create(nestFileIdx);
+        child.io.output<double, 2>(nestFileIdx, nest->childTimeIdx(),
+                                   {&child.u, &child.v, &child.gd});
+        child.io.output<double>(nestFileIdx, {&child.ghs});
+        child.io.close(nestFileIdx);
+    };
+    PyramidOutput pyramid;
+    if (numPyramidLevel > 0) {
+        pyramid.init(*this, *timeManager, numPyramidLevel, 3600, outputPrefix);
+    }
+    StationOutput stations;
+    if (!stationFileName.empty()) {
+        stations.init(*this, stationFileName, outputPrefix+".stations");
+    }
+    StateStream stream;
+    if (!streamName.empty()) {
+        stream.create(*this, streamName, streamDecimation);
+    }
+    // Apply the forcing of the start, which then changes along the steps.
+    if (forcingStream != NULL) {
+        forcingStream->update(0);
+    }
     // Output the initial condition.
-    io.create(fileIdx);
-    io.output<double, 2>(fileIdx, oldTimeIdx, {&u, &v, &gd});
-    io.output<double>(fileIdx, {&ghs});
-    io.close(fileIdx);
+    if (reducedGrid) {
+        projectToReducedGrid(oldTimeIdx);
+    }
+    output();
+    outputNest();
+    double elapsedSeconds = 0;
+    if (numPyramidLevel > 0) {
+        pyramid.output(oldTimeIdx, elapsedSeconds);
+    }
+    if (!stationFileName.empty()) {
+        stations.output(elapsedSeconds);
+    }
+    int numStep = 0;
+    if (!streamName.empty()) {
+        stream.publish(elapsedSeconds, numStep);
+    }
     // Start the main integration loop.
     while (!timeManager->isFinished()) {
-        integrate(oldTimeIdx, timeManager->stepSizeInSeconds());
-        timeManager->advance();
-        oldTimeIdx.shift();
-        io.create(fileIdx);
-        io.output<double, 2>(fileIdx, oldTimeIdx, {&u, &v, &gd});
-        io.output<double>(fileIdx, {&ghs});
-        io.close(fileIdx);
+        if (nest != NULL) {
+            nest->step();
+        } else {
+            step();
+        }
+        elapsedSeconds += timeManager->stepSizeInSeconds();
+        ++numStep;
+        if (forcingStream != NULL) {
+            forcingStream->update(elapsedSeconds);
+        }
+        output();
+        outputNest();
+        if (numPyramidLevel > 0) {
+            pyramid.output(oldTimeIdx, elapsedSeconds);
+        }
+        if (!stationFileName.empty()) {
+            stations.output(elapsedSeconds);
+        }
+        if (!streamName.empty()) {
+            stream.publish(elapsedSeconds, numStep);
+        }
+    }
+    if (forcingStream != NULL && forcingStream->numStallStep() > 0) {
+        REPORT_NOTICE("Forcing stream stalled " << forcingStream->numStallStep() <<
+                      " steps for " << forcingStream->stallTime() << " seconds.");
+    }
+    if (perf.isEnabled()) {
+        perf.report(cout);
     }
 } // run
 
+void BarotropicModel_A_ImplicitMidpoint::
+output() {
+    if (!fieldOutput) return;
+    if (outputFileIdx < 0) {
+        StampString filePattern(outputPrefix+".%5s.nc");
+        outputFileIdx = io.addOutputFile(mesh(), filePattern, hours(1));
+        io.file(outputFileIdx).addField("double", FULL_DIMENSION, {&u, &v, &gd});
+        io.file(outputFileIdx).addField("double", FULL_DIMENSION, {&ghs});
+    }
+    io.create(outputFileIdx);
+    io.output<double, 2>(outputFileIdx, oldTimeIdx, {&u, &v, &gd});
+    io.output<double>(outputFileIdx, {&ghs});
+    io.close(outputFileIdx);
+} // output
+
 void BarotropicModel_A_ImplicitMidpoint::
 integrate(const TimeLevelIndex<2> &oldTimeIdx, double dt) {
     // Set time level indices.
-    halfTimeIdx = oldTimeIdx+0.5;
+    // Note: The new level is not seeded by copying the old one. The first
+    //       iteration reads the old level in its place, and the rotation of
+    //       the time level indices after each step reuses the buffers.
     newTimeIdx = oldTimeIdx+1;
-    // Copy the old variables to the new ones to start the iteration.
-    for (int j = mesh().js(FULL); j <= mesh().je(FULL); ++j) {
-        for (int i = mesh().is(FULL)-1; i <= mesh().ie(FULL)+1; ++i) {
-            u(newTimeIdx, i, j) = u(oldTimeIdx, i, j);
-            v(newTimeIdx, i, j) = v(oldTimeIdx, i, j);
-            gd(newTimeIdx, i, j) = gd(oldTimeIdx, i, j);
-            gdt(oldTimeIdx, i, j) = sqrt(gd(oldTimeIdx, i, j));
-            gdt(newTimeIdx, i, j) = gdt(oldTimeIdx, i, j);
-            ut(oldTimeIdx, i, j) = u(oldTimeIdx, i, j)*gdt(oldTimeIdx, i, j);
-            ut(newTimeIdx, i, j) = ut(oldTimeIdx, i, j);
-            vt(oldTimeIdx, i, j) = v(oldTimeIdx, i, j)*gdt(oldTimeIdx, i, j);
-            vt(newTimeIdx, i, j) = vt(oldTimeIdx, i, j);
+    if (reducedGrid) {
+        projectToReducedGrid(oldTimeIdx);
+    }
+    // Transform the variables on the old time level, and rebuild the cached
+    // terms of the surface geopotential if it has been changed.
+    // Note: In a region, the boundary ring is transformed as well, also on
+    //       the new time level, where it is given before the step.
+    {
+        PerfStage stage(perf, PERF_TRANSFORM);
+        if (!leanMemory) {
+            evaluateRegion(regionIs-1, regionIe+1, ringJs(), ringJe(),
+                           assign(level(gdt, oldTimeIdx), sqrt(level(gd, oldTimeIdx))),
+                           assign(level(ut, oldTimeIdx), level(u, oldTimeIdx)*level(gdt, oldTimeIdx)),
+                           assign(level(vt, oldTimeIdx), level(v, oldTimeIdx)*level(gdt, oldTimeIdx)));
+            if (isRegional()) {
+                evaluateRegion(regionIs-1, regionIe+1, ringJs(), ringJe(),
+                               assign(level(gdt, newTimeIdx), sqrt(level(gd, newTimeIdx))),
+                               assign(level(ut, newTimeIdx), level(u, newTimeIdx)*level(gdt, newTimeIdx)),
+                               assign(level(vt, newTimeIdx), level(v, newTimeIdx)*level(gdt, newTimeIdx)));
+            }
+        }
+        if (ghsChanged) {
+            buildSurfaceGeopotentialCache();
         }
     }
     // Get the old total energy and mass.
-    double e0 = calcTotalEnergy(oldTimeIdx);
-    double m0 = calcTotalMass(oldTimeIdx);
+    double e0, m0;
+    {
+        PerfStage stage(perf, PERF_DIAGNOSTICS);
+        e0 = calcTotalEnergy(oldTimeIdx);
+        m0 = calcTotalMass(oldTimeIdx);
+    }
+    if (verbose) {
 #ifndef NDEBUG
-    cout << "iteration ";
+        cout << "iteration ";
 #endif
-    cout << "energy: ";
-    cout << std::fixed << setw(20) << setprecision(2) << e0 << "  ";
-    cout << "mass: ";
-    cout << setw(20) << setprecision(2) << m0 << endl;
-    // Run iterations.
-    for (int iter = 1; iter <= 8; ++iter) {
-        // Calculate the variables on the half time step.
-        for (int j = mesh().js(FULL); j <= mesh().je(FULL); ++j) {
-            for (int i = mesh().is(FULL)-1; i <= mesh().ie(FULL)+1; ++i) {
-                u(halfTimeIdx, i, j) = (u(oldTimeIdx, i, j)+u(newTimeIdx, i, j))*0.5;
-                v(halfTimeIdx, i, j) = (v(oldTimeIdx, i, j)+v(newTimeIdx, i, j))*0.5;
-                gd(halfTimeIdx, i, j) = (gd(oldTimeIdx, i, j)+gd(newTimeIdx, i, j))*0.5;
-                ut(halfTimeIdx, i, j) = (ut(oldTimeIdx, i, j)+ut(newTimeIdx, i, j))*0.5;
-                vt(halfTimeIdx, i, j) = (vt(oldTimeIdx, i, j)+vt(newTimeIdx, i, j))*0.5;
-                gdt(halfTimeIdx, i, j) = (gdt(oldTimeIdx, i, j)+gdt(newTimeIdx, i, j))*0.5;
+        cout << "energy: ";
+        cout << std::fixed << setw(20) << setprecision(2) << e0 << "  ";
+        cout << "mass: ";
+        cout << setw(20) << setprecision(2) << m0 << endl;
+    }
+    // Set up the task graphs once. They read the time levels and the time
+    // step from the members, so they can be reused by all the steps.
+    if (taskPool != NULL) {
+        graphOldTimeIdx = oldTimeIdx;
+        graphDt = dt;
+        if (taskGraphs[0].numTask() == 0) {
+            const TimeLevelIndex<2> &o = graphOldTimeIdx, &n = newTimeIdx;
+            if (leanMemory) {
+                buildTaskGraph(taskGraphs[0], true,
+                               LeanState(u, v, gd, ghs, o, o, o),
+                               LeanState(u, v, gd, ghs, o, o, n));
+                buildTaskGraph(taskGraphs[1], false,
+                               LeanState(u, v, gd, ghs, o, n, n),
+                               LeanState(u, v, gd, ghs, o, n, n));
+            } else {
+                buildTaskGraph(taskGraphs[0], true,
+                               FullState(u, v, gd, ut, vt, gdt, ghsDx, ghsDy, o, o, o),
+                               FullState(u, v, gd, ut, vt, gdt, ghsDx, ghsDy, o, o, n));
+                buildTaskGraph(taskGraphs[1], false,
+                               FullState(u, v, gd, ut, vt, gdt, ghsDx, ghsDy, o, n, n),
+                               FullState(u, v, gd, ut, vt, gdt, ghsDx, ghsDy, o, n, n));
             }
         }
-        // Update the geopotential height.
-        calcGeopotentialDepthTendency(halfTimeIdx);
-        for (int j = mesh().js(FULL); j <= mesh().je(FULL); ++j) {
-            for (int i = mesh().is(FULL); i <= mesh().ie(FULL); ++i) {
-                gd(newTimeIdx, i, j) = gd(oldTimeIdx, i, j)-dt*dgd(i, j);
+    }
+    // Run iterations.
+    double eLast = e0;
+    for (int iter = 1; iter <= maxIteration; ++iter) {
+        _numIteration = iter;
+        // The time levels that hold the latest estimates of the new winds and
+        // geopotential depth.
+        const TimeLevelIndex<2> &windTimeIdx = iter == 1 ? oldTimeIdx : newTimeIdx;
+        const TimeLevelIndex<2> &gdTimeIdx = iter == 1 ? oldTimeIdx : newTimeIdx;
+        double e1;
+        if (taskPool != NULL) {
+            // Run the iteration as a task graph, which also sums the energy
+            // on each row.
+            taskGraphs[iter == 1 ? 0 : 1].run(*taskPool);
+            e1 = 0.0;
+            for (int j = mesh().js(FULL); j <= mesh().je(FULL); ++j) {
+                e1 += rowSum[j];
             }
-        }
-        gd.applyBndCond(newTimeIdx, UPDATE_HALF_LEVEL);
-        // Transform the geopotential height.
-        for (int j = mesh().js(FULL); j <= mesh().je(FULL); ++j) {
-            for (int i = mesh().is(FULL); i <= mesh().ie(FULL); ++i) {
-                gdt(newTimeIdx, i, j) = sqrt(gd(newTimeIdx, i, j));
+        } else {
+            // Update the geopotential height.
+            {
+                PerfStage stage(perf, PERF_GEOPOTENTIAL_DEPTH_TENDENCY);
+                if (leanMemory) {
+                    calcGeopotentialDepthTendency(LeanState(u, v, gd, ghs,
+                                                            oldTimeIdx, windTimeIdx,
+                                                            gdTimeIdx));
+                } else {
+                    calcGeopotentialDepthTendency(FullState(u, v, gd, ut, vt, gdt,
+                                                            ghsDx, ghsDy,
+                                                            oldTimeIdx, windTimeIdx,
+                                                            gdTimeIdx));
+                }
             }
-        }
-        gdt.applyBndCond(newTimeIdx, UPDATE_HALF_LEVEL);
-        // Update the velocity.
-        calcZonalWindTendency(halfTimeIdx);
-        calcMeridionalWindTendency(halfTimeIdx);
-        for (int j = mesh().js(FULL); j <= mesh().je(FULL); ++j) {
-            for (int i = mesh().is(FULL); i <= mesh().ie(FULL); ++i) {
-                ut(newTimeIdx, i, j) = ut(oldTimeIdx, i, j)-dt*dut(i, j);
-                vt(newTimeIdx, i, j) = vt(oldTimeIdx, i, j)-dt*dvt(i, j);
+            {
+                PerfStage stage(perf, PERF_GEOPOTENTIAL_DEPTH_UPDATE);
+                #pragma omp parallel for
+                for (int j = regionJs; j <= regionJe; ++j) {
+                    updateGeopotentialDepth(oldTimeIdx, dt, j, j);
+                }
             }
-        }
-        ut.applyBndCond(newTimeIdx, UPDATE_HALF_LEVEL);
-        vt.applyBndCond(newTimeIdx, UPDATE_HALF_LEVEL);
-        // Transform back velocity on the new time level.
-        for (int j = mesh().js(FULL); j <= mesh().je(FULL); ++j) {
-            for (int i = mesh().is(FULL); i <= mesh().ie(FULL); ++i) {
-                u(newTimeIdx, i, j) = ut(newTimeIdx, i, j)/gdt(newTimeIdx, i, j);
-                v(newTimeIdx, i, j) = vt(newTimeIdx, i, j)/gdt(newTimeIdx, i, j);
+            // Update the velocity.
+            if (leanMemory) {
+                LeanState state(u, v, gd, ghs, oldTimeIdx, windTimeIdx,
+                                newTimeIdx);
+                {
+                    PerfStage stage(perf, PERF_ZONAL_WIND_TENDENCY);
+                    calcZonalWindTendency(state);
+                }
+                {
+                    PerfStage stage(perf, PERF_MERIDIONAL_WIND_TENDENCY);
+                    calcMeridionalWindTendency(state);
+                }
+            } else {
+                FullState state(u, v, gd, ut, vt, gdt, ghsDx, ghsDy,
+                                oldTimeIdx, windTimeIdx, newTimeIdx);
+                {
+                    PerfStage stage(perf, PERF_ZONAL_WIND_TENDENCY);
+                    calcZonalWindTendency(state);
+                }
+                {
+                    PerfStage stage(perf, PERF_MERIDIONAL_WIND_TENDENCY);
+                    calcMeridionalWindTendency(state);
+                }
+            }
+            {
+                PerfStage stage(perf, PERF_WIND_UPDATE);
+                #pragma omp parallel for
+                for (int j = regionJs; j <= regionJe; ++j) {
+                    updateWind(oldTimeIdx, dt, j, j);
+                }
+            }
+            // Get the new total energy and mass.
+            {
+                PerfStage stage(perf, PERF_DIAGNOSTICS);
+                e1 = calcTotalEnergy(newTimeIdx);
             }
         }
-        u.applyBndCond(newTimeIdx, UPDATE_HALF_LEVEL);
-        v.applyBndCond(newTimeIdx, UPDATE_HALF_LEVEL);
-        // Get the new total energy and mass.
-        double e1 = calcTotalEnergy(newTimeIdx);
         // TODO: Figure out how this early iteration abortion works.
-        if (fabs(e1-e0)*2/(e1+e0) < 5.0e-15) {
+        // Note: The energy of a region is not conserved due to the boundary
+        //       fluxes, so the iterations stop when it does not change.
+        if (fabs(e1-(isRegional() ? eLast : e0))*2/(e1+e0) < 5.0e-15) {
             break;
         }
+        eLast = e1;
 #ifndef NDEBUG
+        if (!verbose) continue;
         double m1 = calcTotalMass(newTimeIdx);
         cout << setw(9) << iter;
         cout << " energy: ";
@@ -214,58 +720,370 @@ integrate(const TimeLevelIndex<2> &oldTimeIdx, double dt) {
     }
 } // integrate
 
+/**
+ *  Update the geopotential depth on the rows from j0 to j1 of the region in
+ *  the calling thread, and transform it at once.
+ */
+void BarotropicModel_A_ImplicitMidpoint::
+updateGeopotentialDepth(const TimeLevelIndex<2> &oldTimeIdx, double dt,
+                        int j0, int j1) {
+    if (leanMemory) {
+        evaluateRows(regionIs, regionIe, j0, j1,
+                     assign(level(gd, newTimeIdx),
+                            level(gd, oldTimeIdx)-dt*level(dgd)));
+    } else {
+        evaluateRows(regionIs, regionIe, j0, j1,
+                     assign(level(gd, newTimeIdx),
+                            level(gd, oldTimeIdx)-dt*level(dgd)),
+                     assign(level(gdt, newTimeIdx),
+                            sqrt(level(gd, newTimeIdx))));
+    }
+} // updateGeopotentialDepth
+
+/**
+ *  Update the transformed winds on the rows from j0 to j1 of the region in
+ *  the calling thread, and transform them back at once.
+ */
+void BarotropicModel_A_ImplicitMidpoint::
+updateWind(const TimeLevelIndex<2> &oldTimeIdx, double dt, int j0, int j1) {
+    if (leanMemory) {
+        evaluateRows(regionIs, regionIe, j0, j1,
+                     assign(level(u, newTimeIdx),
+                            (level(u, oldTimeIdx)*sqrt(level(gd, oldTimeIdx))-
+                             dt*level(dut))/sqrt(level(gd, newTimeIdx))),
+                     assign(level(v, newTimeIdx),
+                            (level(v, oldTimeIdx)*sqrt(level(gd, oldTimeIdx))-
+                             dt*level(dvt))/sqrt(level(gd, newTimeIdx))));
+    } else {
+        evaluateRows(regionIs, regionIe, j0, j1,
+                     assign(level(ut, newTimeIdx),
+                            level(ut, oldTimeIdx)-dt*level(dut)),
+                     assign(level(vt, newTimeIdx),
+                            level(vt, oldTimeIdx)-dt*level(dvt)),
+                     assign(level(u, newTimeIdx),
+                            level(ut, newTimeIdx)/level(gdt, newTimeIdx)),
+                     assign(level(v, newTimeIdx),
+                            level(vt, newTimeIdx)/level(gdt, newTimeIdx)));
+    }
+} // updateWind
+
+// Resources of the task graph, which are accessed by bands of rows.
+enum TaskGraphResource {
+    RES_GD_FLUX = 0, RES_ZONAL_FLUX, RES_MERIDIONAL_FLUX, RES_DGD, RES_DUT,
+    RES_DVT, RES_NEW_GD, RES_NEW_WIND, RES_ROW_SUM
+};
+
+/**
+ *  Add the tasks of one iteration in the order of the stages, so that the
+ *  derived dependencies keep the results of the stage-by-stage run. The new
+ *  level is read by the geopotential depth stages only after the first
+ *  iteration (gdState), but always by the pressure gradient (windState).
+ *  In the memory-lean mode, the transformed winds are derived from the
+ *  geopotential depth as well.
+ */
+template <class State>
+void BarotropicModel_A_ImplicitMidpoint::
+buildTaskGraph(TaskGraph &graph, bool isFirstIteration, const State &gdState,
+               const State &windState) {
+    graph.clear();
+    int js = mesh().js(FULL), je = mesh().je(FULL);
+    int numBand = (je-js)/taskBandSize+1;
+    // Return the access to the rows from j0 to j1 of a resource.
+    auto rows = [=] (int resource, int j0, int j1) {
+        TaskGraph::Access access = {
+            resource, (std::max(j0, js)-js)/taskBandSize,
+            (std::min(j1, je)-js)/taskBandSize
+        };
+        return access;
+    };
+    vector<TaskGraph::Access> none;
+    vector<int> j0s(numBand), j1s(numBand), k0s(numBand), k1s(numBand);
+    for (int b = 0; b < numBand; ++b) {
+        j0s[b] = js+b*taskBandSize;
+        j1s[b] = std::min(j0s[b]+taskBandSize-1, je);
+        // interior rows
+        k0s[b] = std::max(j0s[b], js+1);
+        k1s[b] = std::min(j1s[b], je-1);
+    }
+    // the new winds (and depth in the memory-lean mode) read by the kernels
+    auto windReads = [=] (int j0, int j1, bool isNewRead) {
+        vector<TaskGraph::Access> reads;
+        if (isNewRead) {
+            reads.push_back(rows(RES_NEW_WIND, j0, j1));
+            if (leanMemory) reads.push_back(rows(RES_NEW_GD, j0, j1));
+        }
+        return reads;
+    };
+    // Update the geopotential depth.
+    for (int b = 0; b < numBand; ++b) {
+        int k0 = k0s[b], k1 = k1s[b];
+        if (k0 > k1) continue;
+        vector<TaskGraph::Access> reads = windReads(k0, k1, !isFirstIteration);
+        if (!isFirstIteration) reads.push_back(rows(RES_NEW_GD, k0, k1));
+        graph.addTask([=] () {
+            for (int j = k0; j <= k1; ++j) calcGeopotentialDepthFlux(gdState, j);
+        }, reads, {rows(RES_GD_FLUX, k0, k1)});
+    }
+    for (int b = 0; b < numBand; ++b) {
+        int k0 = k0s[b], k1 = k1s[b];
+        if (k0 > k1) continue;
+        graph.addTask([=] () {
+            for (int j = k0; j <= k1; ++j) calcGeopotentialDepthTendency(j);
+        }, {rows(RES_GD_FLUX, k0-1, k1+1)}, {rows(RES_DGD, k0, k1)});
+    }
+    graph.addTask([=] () {
+        calcGeopotentialDepthPoleTendency();
+    }, {rows(RES_GD_FLUX, js+1, js+1), rows(RES_GD_FLUX, je-1, je-1)},
+       {rows(RES_DGD, js, js), rows(RES_DGD, je, je)});
+    for (int b = 0; b < numBand; ++b) {
+        int j0 = j0s[b], j1 = j1s[b];
+        graph.addTask([=] () {
+            updateGeopotentialDepth(graphOldTimeIdx, graphDt, j0, j1);
+        }, {rows(RES_DGD, j0, j1)}, {rows(RES_NEW_GD, j0, j1)});
+    }
+    // Calculate the wind tendencies. The advection has its own flux buffers,
+    // so it does not wait for the geopotential depth stages.
+    for (int b = 0; b < numBand; ++b) {
+        int k0 = k0s[b], k1 = k1s[b];
+        if (k0 > k1) continue;
+        graph.addTask([=] () {
+            for (int j = k0; j <= k1; ++j) {
+                calcZonalWindAdvectionFlux(windState, j, fuZonal, fvZonal);
+            }
+        }, windReads(k0, k1, !isFirstIteration), {rows(RES_ZONAL_FLUX, k0, k1)});
+        graph.addTask([=] () {
+            for (int j = k0; j <= k1; ++j) {
+                calcMeridionalWindAdvectionFlux(windState, j, fuMeridional,
+                                                fvMeridional);
+            }
+        }, windReads(k0, k1, !isFirstIteration), {rows(RES_MERIDIONAL_FLUX, k0, k1)});
+    }
+    for (int b = 0; b < numBand; ++b) {
+        int k0 = k0s[b], k1 = k1s[b];
+        if (k0 > k1) continue;
+        vector<TaskGraph::Access> reads = windReads(k0-1, k1+1, !isFirstIteration);
+        reads.push_back(rows(RES_ZONAL_FLUX, k0-1, k1+1));
+        graph.addTask([=] () {
+            for (int j = k0; j <= k1; ++j) {
+                calcZonalWindAdvection(windState, j, fuZonal, fvZonal);
+                calcZonalWindCoriolis(windState, j);
+            }
+        }, reads, {rows(RES_DUT, k0, k1)});
+        reads.back() = rows(RES_MERIDIONAL_FLUX, k0-1, k1+1);
+        graph.addTask([=] () {
+            for (int j = k0; j <= k1; ++j) {
+                calcMeridionalWindAdvection(windState, j, fuMeridional,
+                                            fvMeridional);
+                calcMeridionalWindCoriolis(windState, j);
+            }
+        }, reads, {rows(RES_DVT, k0, k1)});
+    }
+    for (int b = 0; b < numBand; ++b) {
+        int k0 = k0s[b], k1 = k1s[b];
+        if (k0 > k1) continue;
+        graph.addTask([=] () {
+            for (int j = k0; j <= k1; ++j) {
+                calcZonalWindPressureGradient(windState, j);
+            }
+        }, {rows(RES_NEW_GD, k0-1, k1+1)}, {rows(RES_DUT, k0, k1)});
+        graph.addTask([=] () {
+            for (int j = k0; j <= k1; ++j) {
+                calcMeridionalWindPressureGradient(windState, j);
+            }
+        }, {rows(RES_NEW_GD, k0-1, k1+1)}, {rows(RES_DVT, k0, k1)});
+    }
+    // Update the winds and sum the energy on each row.
+    for (int b = 0; b < numBand; ++b) {
+        int j0 = j0s[b], j1 = j1s[b];
+        graph.addTask([=] () {
+            updateWind(graphOldTimeIdx, graphDt, j0, j1);
+        }, {rows(RES_DUT, j0, j1), rows(RES_DVT, j0, j1), rows(RES_NEW_GD, j0, j1)},
+           {rows(RES_NEW_WIND, j0, j1)});
+        graph.addTask([=] () {
+            for (int j = j0; j <= j1; ++j) {
+                rowSum[j] = calcRowEnergy(newTimeIdx, j, true);
+            }
+        }, {rows(RES_NEW_WIND, j0, j1), rows(RES_NEW_GD, j0, j1)},
+           {rows(RES_ROW_SUM, j0, j1)});
+    }
+} // buildTaskGraph
+
+void BarotropicModel_A_ImplicitMidpoint::
+projectToReducedGrid(const TimeLevelIndex<2> &timeIdx) {
+    bool isGhsChanged = false;
+    #pragma omp parallel for reduction(||:isGhsChanged)
+    for (int j = mesh().js(FULL)+1; j <= mesh().je(FULL)-1; ++j) {
+        int r = reduceFactor[j];
+        if (r == 1) continue;
+        for (int i = mesh().is(FULL); i <= mesh().ie(FULL); i += r) {
+            averageBlock(level(u, timeIdx), i, j, r);
+            averageBlock(level(v, timeIdx), i, j, r);
+            averageBlock(level(gd, timeIdx), i, j, r);
+            if (averageBlock(level(ghs), i, j, r)) {
+                isGhsChanged = true;
+            }
+        }
+    }
+    ghsChanged = ghsChanged || isGhsChanged;
+    BoundaryExchange::run(timeIdx, {&u, &v, &gd});
+    BoundaryExchange::run({&ghs});
+} // projectToReducedGrid
+
+void BarotropicModel_A_ImplicitMidpoint::
+buildSurfaceGeopotentialCache() {
+    ghsChanged = false;
+    if (!hasSurfaceGeopotentialCache()) return;
+    #pragma omp parallel for
+    for (int j = tendencyJs(); j <= tendencyJe(); ++j) {
+        // Note: Only the first cell of each block is read on the reduced rows.
+        int r = reduceFactor[j];
+        for (int i = regionIs; i <= regionIe; ++i) {
+            ghsDx(i, j) = ghs(i+r, j)-ghs(i-1, j);
+            ghsDy(i, j) = ghs(i, j+1)-ghs(i, j-1);
+        }
+    }
+} // buildSurfaceGeopotentialCache
+
 double BarotropicModel_A_ImplicitMidpoint::
-calcTotalEnergy(const TimeLevelIndex<2> &timeIdx) const {
+calcTotalEnergy(const TimeLevelIndex<2> &timeIdx, bool useTransformed) const {
+    // Note: The sums are accumulated by rows and then added up in order, so
+    //       the result does not depend on the number of threads.
+    #pragma omp parallel for
+    for (int j = regionJs; j <= regionJe; ++j) {
+        rowSum[j] = calcRowEnergy(timeIdx, j, useTransformed);
+    }
     double totalEnergy = 0.0;
-    for (int j = mesh().js(FULL); j <= mesh().je(FULL); ++j) {
-        for (int i = mesh().is(FULL); i <= mesh().ie(FULL); ++i) {
-            totalEnergy += (pow(ut(timeIdx, i, j), 2)+
-                            pow(vt(timeIdx, i, j), 2)+
-                            pow(gd(timeIdx, i, j)+ghs(i, j), 2))*cosLat[j];
-        }
+    for (int j = regionJs; j <= regionJe; ++j) {
+        totalEnergy += rowSum[j];
     }
     return totalEnergy;
 } // calcTotalEnergy
 
+double BarotropicModel_A_ImplicitMidpoint::
+calcRowEnergy(const TimeLevelIndex<2> &timeIdx, int j,
+              bool useTransformed) const {
+    double rowEnergy = 0.0;
+    if (leanMemory || !useTransformed) {
+        // Note: ut*ut+vt*vt = (u*u+v*v)*gd.
+        for (int i = regionIs; i <= regionIe; ++i) {
+            rowEnergy += ((pow(u(timeIdx, i, j), 2)+
+                           pow(v(timeIdx, i, j), 2))*gd(timeIdx, i, j)+
+                          pow(gd(timeIdx, i, j)+ghs(i, j), 2))*cosLat[j];
+        }
+    } else {
+        for (int i = regionIs; i <= regionIe; ++i) {
+            rowEnergy += (pow(ut(timeIdx, i, j), 2)+
+                          pow(vt(timeIdx, i, j), 2)+
+                          pow(gd(timeIdx, i, j)+ghs(i, j), 2))*cosLat[j];
+        }
+    }
+    return rowEnergy;
+} // calcRowEnergy
+
 double BarotropicModel_A_ImplicitMidpoint::
 calcTotalMass(const TimeLevelIndex<2> &timeIdx) const {
-    double totalMass = 0.0;
-    for (int j = mesh().js(FULL); j <= mesh().je(FULL); ++j) {
-        for (int i = mesh().is(FULL); i <= mesh().ie(FULL); ++i) {
-            totalMass += gd(timeIdx, i, j)*cosLat[j];
+    #pragma omp parallel for
+    for (int j = regionJs; j <= regionJe; ++j) {
+        double rowMass = 0.0;
+        for (int i = regionIs; i <= regionIe; ++i) {
+            rowMass += gd(timeIdx, i, j)*cosLat[j];
         }
+        rowSum[j] = rowMass;
+    }
+    double totalMass = 0.0;
+    for (int j = regionJs; j <= regionJe; ++j) {
+        totalMass += rowSum[j];
     }
     return totalMass;
 } // calcTotalMass
 
 /**
  *  Input: ut, vt, gdt
- *  Intermediate: gdu, gdv
+ *  Intermediate: fu, fv
  *  Output: dgd
  */
+template <class State>
 void BarotropicModel_A_ImplicitMidpoint::
-calcGeopotentialDepthTendency(const TimeLevelIndex<2> &timeIdx) {
+calcGeopotentialDepthTendency(const State &state) {
     // calculate intermediate variables
-    for (int j = mesh().js(FULL)+1; j <= mesh().je(FULL)-1; ++j) {
-        for (int i = mesh().is(FULL)-1; i <= mesh().ie(FULL)+1; ++i) {
-            gdu(i, j) = ut(timeIdx, i, j)*gdt(timeIdx, i, j);
-            gdv(i, j) = vt(timeIdx, i, j)*gdt(timeIdx, i, j)*cosLat[j];
-        }
+    #pragma omp parallel for
+    for (int j = fluxJs(); j <= fluxJe(); ++j) {
+        calcGeopotentialDepthFlux(state, j);
     }
     // normal grids
-    for (int j = mesh().js(FULL)+1; j <= mesh().je(FULL)-1; ++j) {
+    #pragma omp parallel for
+    for (int j = tendencyJs(); j <= tendencyJe(); ++j) {
+        calcGeopotentialDepthTendency(j);
+    }
+    // pole grids
+    // Note: A region has open boundaries, so the total mass is not conserved.
+    if (isRegional()) return;
+    calcGeopotentialDepthPoleTendency();
+#ifndef NDEBUG
+    double tmp = 0.0;
+    for (int j = mesh().js(FULL); j <= mesh().je(FULL); ++j) {
         for (int i = mesh().is(FULL); i <= mesh().ie(FULL); ++i) {
-            dgd(i, j) = (gdu(i+1, j)-gdu(i-1, j))*factorLon[j]+
-                        (gdv(i, j+1)-gdv(i, j-1))*factorLat[j];
+            tmp += dgd(i, j)*cosLat[j];
         }
     }
-    // pole grids
+    assert(fabs(tmp) < 1.0e-10);
+#endif
+} // calcGeopotentialDepthTendency
+
+/**
+ *  Input: ut, vt, gdt on row j
+ *  Output: fu, fv on row j
+ */
+template <class State>
+void BarotropicModel_A_ImplicitMidpoint::
+calcGeopotentialDepthFlux(const State &state, int j) {
+    for (int i = regionIs-1; i <= regionIe+1; ++i) {
+        double gdt = state.gdt(i, j);
+        fu(i, j) = state.ut(i, j)*gdt;
+        fv(i, j) = state.vt(i, j)*gdt*cosLat[j];
+    }
+} // calcGeopotentialDepthFlux
+
+/**
+ *  Input: fu, fv on rows j-1, j, j+1
+ *  Output: dgd on row j
+ */
+void BarotropicModel_A_ImplicitMidpoint::
+calcGeopotentialDepthTendency(int j) {
+    int r = reduceFactor[j];
+    if (r == 1) {
+        for (int i = regionIs; i <= regionIe; ++i) {
+            dgd(i, j) = (fu(i+1, j)-fu(i-1, j))*factorLon[j]+
+                        (fv(i, j+1)-fv(i, j-1))*factorLat[j];
+        }
+        return;
+    }
+    // reduced rows
+    for (int i = regionIs; i <= regionIe; i += r) {
+        double dy = 0.0;
+        for (int k = 0; k < r; ++k) {
+            dy += fv(i+k, j+1)-fv(i+k, j-1);
+        }
+        double tendency = (fu(i+r, j)-fu(i-1, j))*factorLon[j]+
+                          dy*blockWeight[j]*factorLat[j];
+        for (int k = 0; k < r; ++k) {
+            dgd(i+k, j) = tendency;
+        }
+    }
+} // calcGeopotentialDepthTendency
+
+/**
+ *  Input: fv on the rows next to the Poles
+ *  Output: dgd on the Poles
+ */
+void BarotropicModel_A_ImplicitMidpoint::
+calcGeopotentialDepthPoleTendency() {
     // last character 's' and 'n' mean 'Sorth Pole' and 'North Pole' respectively
     int js = mesh().js(FULL), jn = mesh().je(FULL);
     double dgds = 0.0, dgdn = 0.0;
     for (int i = mesh().is(FULL); i <= mesh().ie(FULL); ++i) {
-        dgds += gdv(i, js+1);
-        dgdn -= gdv(i, jn-1);
+        dgds += fv(i, js+1);
+        dgdn -= fv(i, jn-1);
     }
     dgds *= factorLat[js]/mesh().numGrid(0, FULL);
     dgdn *= factorLat[jn]/mesh().numGrid(0, FULL);
@@ -273,133 +1091,230 @@ calcGeopotentialDepthTendency(const TimeLevelIndex<2> &timeIdx) {
         dgd(i, js) = dgds;
         dgd(i, jn) = dgdn;
     }
-#ifndef NDEBUG
-    double tmp = 0.0;
-    for (int j = mesh().js(FULL); j <= mesh().je(FULL); ++j) {
-        for (int i = mesh().is(FULL); i <= mesh().ie(FULL); ++i) {
-            tmp += dgd(i, j)*cosLat[j];
-        }
-    }
-    assert(fabs(tmp) < 1.0e-10);
-#endif
-} // calcGeopotentialDepthTendency
+} // calcGeopotentialDepthPoleTendency
 
+/**
+ *  Input: u, v, ut, vt, gd, gdt
+ *  Intermediate: fu, fv
+ *  Output: dut
+ */
+template <class State>
 void BarotropicModel_A_ImplicitMidpoint::
-calcZonalWindTendency(const TimeLevelIndex<2> &timeIdx) {
-    calcZonalWindAdvection(timeIdx);
-    calcZonalWindCoriolis(timeIdx);
-    calcZonalWindPressureGradient(timeIdx);
+calcZonalWindTendency(const State &state) {
+    #pragma omp parallel for
+    for (int j = fluxJs(); j <= fluxJe(); ++j) {
+        calcZonalWindAdvectionFlux(state, j, fu, fv);
+    }
+    // normal grids
+    #pragma omp parallel for
+    for (int j = tendencyJs(); j <= tendencyJe(); ++j) {
+        calcZonalWindAdvection(state, j, fu, fv);
+        calcZonalWindCoriolis(state, j);
+        calcZonalWindPressureGradient(state, j);
+    }
 } // calcZonalWindTendency
 
+/**
+ *  Input: u, v, ut, vt, gd, gdt
+ *  Intermediate: fu, fv
+ *  Output: dvt
+ */
+template <class State>
 void BarotropicModel_A_ImplicitMidpoint::
-calcMeridionalWindTendency(const TimeLevelIndex<2> &timeIdx) {
-    calcMeridionalWindAdvection(timeIdx);
-    calcMeridionalWindCoriolis(timeIdx);
-    calcMeridionalWindPressureGradient(timeIdx);
+calcMeridionalWindTendency(const State &state) {
+    #pragma omp parallel for
+    for (int j = fluxJs(); j <= fluxJe(); ++j) {
+        calcMeridionalWindAdvectionFlux(state, j, fu, fv);
+    }
+    // normal grids
+    #pragma omp parallel for
+    for (int j = tendencyJs(); j <= tendencyJe(); ++j) {
+        calcMeridionalWindAdvection(state, j, fu, fv);
+        calcMeridionalWindCoriolis(state, j);
+        calcMeridionalWindPressureGradient(state, j);
+    }
 } // calcMeridionalWindTendency
 
 /**
- *  Input: u, v, ut
- *  Output, s1
+ *  Input: u, v, ut on row j
+ *  Output: fluxLon, fluxLat on row j
  */
+template <class State>
 void BarotropicModel_A_ImplicitMidpoint::
-calcZonalWindAdvection(const TimeLevelIndex<2> &timeIdx) {
-    for (int j = mesh().js(FULL)+1; j <= mesh().je(FULL)-1; ++j) {
-        for (int i = mesh().is(FULL)-1; i <= mesh().ie(FULL)+1; ++i) {
-            fu(i, j) = ut(timeIdx, i, j)*u(timeIdx, i, j);
-            fv(i, j) = ut(timeIdx, i, j)*v(timeIdx, i, j)*cosLat[j];
-        }
+calcZonalWindAdvectionFlux(const State &state, int j, ArenaField &fluxLon,
+                           ArenaField &fluxLat) {
+    for (int i = regionIs-1; i <= regionIe+1; ++i) {
+        double ut = state.ut(i, j);
+        fluxLon(i, j) = ut*state.u(i, j);
+        fluxLat(i, j) = ut*state.v(i, j)*cosLat[j];
     }
-    // normal grids
-    for (int j = mesh().js(FULL)+1; j <= mesh().je(FULL)-1; ++j) {
-        for (int i = mesh().is(FULL); i <= mesh().ie(FULL); ++i) {
-            double dx1 = fu(i+1, j)-fu(i-1, j);
-            double dy1 = fv(i, j+1)-fv(i, j-1);
-            double dx2 = u(timeIdx, i, j)*(ut(timeIdx, i+1, j)-ut(timeIdx, i-1, j));
-            double dy2 = v(timeIdx, i, j)*(ut(timeIdx, i, j+1)-ut(timeIdx, i, j-1))*cosLat[j];
+} // calcZonalWindAdvectionFlux
+
+/**
+ *  Input: fluxLon, fluxLat, ut on rows j-1, j, j+1
+ *  Output: dut on row j
+ */
+template <class State>
+void BarotropicModel_A_ImplicitMidpoint::
+calcZonalWindAdvection(const State &state, int j, const ArenaField &fluxLon,
+                       const ArenaField &fluxLat) {
+    int r = reduceFactor[j];
+    if (r == 1) {
+        for (int i = regionIs; i <= regionIe; ++i) {
+            double dx1 = fluxLon(i+1, j)-fluxLon(i-1, j);
+            double dy1 = fluxLat(i, j+1)-fluxLat(i, j-1);
+            double dx2 = state.u(i, j)*(state.ut(i+1, j)-state.ut(i-1, j));
+            double dy2 = state.v(i, j)*(state.ut(i, j+1)-state.ut(i, j-1))*cosLat[j];
             dut(i, j) = 0.5*((dx1+dx2)*factorLon[j]+(dy1+dy2)*factorLat[j]);
         }
+        return;
+    }
+    // reduced rows
+    for (int i = regionIs; i <= regionIe; i += r) {
+        double dy1 = 0.0, dy = 0.0;
+        for (int k = 0; k < r; ++k) {
+            dy1 += fluxLat(i+k, j+1)-fluxLat(i+k, j-1);
+            dy += state.ut(i+k, j+1)-state.ut(i+k, j-1);
+        }
+        double dx1 = fluxLon(i+r, j)-fluxLon(i-1, j);
+        double dx2 = state.u(i, j)*(state.ut(i+r, j)-state.ut(i-1, j));
+        double dy2 = state.v(i, j)*dy*blockWeight[j]*cosLat[j];
+        double tendency = 0.5*((dx1+dx2)*factorLon[j]+
+                               (dy1*blockWeight[j]+dy2)*factorLat[j]);
+        for (int k = 0; k < r; ++k) {
+            dut(i+k, j) = tendency;
+        }
     }
 } // calcZonalWindAdvection
 
 /**
- *  Input: u, v, vt
- *  Output, dvt
+ *  Input: u, v, vt on row j
+ *  Output: fluxLon, fluxLat on row j
  */
+template <class State>
 void BarotropicModel_A_ImplicitMidpoint::
-calcMeridionalWindAdvection(const TimeLevelIndex<2> &timeIdx) {
-    for (int j = mesh().js(FULL)+1; j <= mesh().je(FULL)-1; ++j) {
-        for (int i = mesh().is(FULL)-1; i <= mesh().ie(FULL)+1; ++i) {
-            fu(i, j) = vt(timeIdx, i, j)*u(timeIdx, i, j);
-            fv(i, j) = vt(timeIdx, i, j)*v(timeIdx, i, j)*cosLat[j];
-        }
+calcMeridionalWindAdvectionFlux(const State &state, int j, ArenaField &fluxLon,
+                                ArenaField &fluxLat) {
+    for (int i = regionIs-1; i <= regionIe+1; ++i) {
+        double vt = state.vt(i, j);
+        fluxLon(i, j) = vt*state.u(i, j);
+        fluxLat(i, j) = vt*state.v(i, j)*cosLat[j];
     }
-    // normal grids
-    for (int j = mesh().js(FULL)+1; j <= mesh().je(FULL)-1; ++j) {
-        for (int i = mesh().is(FULL); i <= mesh().ie(FULL); ++i) {
-            double dx1 = fu(i+1,j)-fu(i-1,j);
-            double dy1 = fv(i,j+1)-fv(i,j-1);
-            double dx2 = u(timeIdx, i, j)*(vt(timeIdx, i+1, j)-vt(timeIdx, i-1, j));
-            double dy2 = v(timeIdx, i, j)*(vt(timeIdx, i, j+1)-vt(timeIdx, i, j-1))*cosLat[j];
+} // calcMeridionalWindAdvectionFlux
+
+/**
+ *  Input: fluxLon, fluxLat, vt on rows j-1, j, j+1
+ *  Output: dvt on row j
+ */
+template <class State>
+void BarotropicModel_A_ImplicitMidpoint::
+calcMeridionalWindAdvection(const State &state, int j,
+                            const ArenaField &fluxLon,
+                            const ArenaField &fluxLat) {
+    int r = reduceFactor[j];
+    if (r == 1) {
+        for (int i = regionIs; i <= regionIe; ++i) {
+            double dx1 = fluxLon(i+1, j)-fluxLon(i-1, j);
+            double dy1 = fluxLat(i, j+1)-fluxLat(i, j-1);
+            double dx2 = state.u(i, j)*(state.vt(i+1, j)-state.vt(i-1, j));
+            double dy2 = state.v(i, j)*(state.vt(i, j+1)-state.vt(i, j-1))*cosLat[j];
             dvt(i, j) = 0.5*((dx1+dx2)*factorLon[j]+(dy1+dy2)*factorLat[j]);
         }
+        return;
+    }
+    // reduced rows
+    for (int i = regionIs; i <= regionIe; i += r) {
+        double dy1 = 0.0, dy = 0.0;
+        for (int k = 0; k < r; ++k) {
+            dy1 += fluxLat(i+k, j+1)-fluxLat(i+k, j-1);
+            dy += state.vt(i+k, j+1)-state.vt(i+k, j-1);
+        }
+        double dx1 = fluxLon(i+r, j)-fluxLon(i-1, j);
+        double dx2 = state.u(i, j)*(state.vt(i+r, j)-state.vt(i-1, j));
+        double dy2 = state.v(i, j)*dy*blockWeight[j]*cosLat[j];
+        double tendency = 0.5*((dx1+dx2)*factorLon[j]+
+                               (dy1*blockWeight[j]+dy2)*factorLat[j]);
+        for (int k = 0; k < r; ++k) {
+            dvt(i+k, j) = tendency;
+        }
     }
 } // calcMeridionalWindAdvection
 
 /**
- *  Input: u, vt
- *  Output: dut
+ *  Input: u, vt on row j
+ *  Output: dut on row j
  */
+template <class State>
 void BarotropicModel_A_ImplicitMidpoint::
-calcZonalWindCoriolis(const TimeLevelIndex<2> &timeIdx) {
-    for (int j = mesh().js(FULL)+1; j <= mesh().je(FULL)-1; ++j) {
-        for (int i = mesh().is(FULL); i <= mesh().ie(FULL); ++i) {
-            double f = factorCor[j]+u(timeIdx, i, j)*factorCur[j];
-            dut(i, j) -= f*vt(timeIdx, i, j);
-        }
+calcZonalWindCoriolis(const State &state, int j) {
+    for (int i = regionIs; i <= regionIe; ++i) {
+        double f = factorCor[j]+state.u(i, j)*factorCur[j];
+        dut(i, j) -= f*state.vt(i, j);
     }
 } // calcZonalWindCoriolis
 
 /**
- *  Input: u, ut
- *  Output: dvt
+ *  Input: u, ut on row j
+ *  Output: dvt on row j
  */
+template <class State>
 void BarotropicModel_A_ImplicitMidpoint::
-calcMeridionalWindCoriolis(const TimeLevelIndex<2> &timeIdx) {
-    for (int j = mesh().js(FULL)+1; j <= mesh().je(FULL)-1; ++j) {
-        for (int i = mesh().is(FULL); i <= mesh().ie(FULL); ++i) {
-            double f = factorCor[j]+u(timeIdx, i, j)*factorCur[j];
-            dvt(i, j) += f*ut(timeIdx, i, j);
-        }
+calcMeridionalWindCoriolis(const State &state, int j) {
+    for (int i = regionIs; i <= regionIe; ++i) {
+        double f = factorCor[j]+state.u(i, j)*factorCur[j];
+        dvt(i, j) += f*state.ut(i, j);
     }
 } // calcMeridionalWindCoriolis
 
 /*
- *  Input: gd, ghs, gdt
- *  Output: dut
+ *  Input: gd, ghsDx, gdt on row j
+ *  Output: dut on row j
  */
+template <class State>
 void BarotropicModel_A_ImplicitMidpoint::
-calcZonalWindPressureGradient(const TimeLevelIndex<2> &timeIdx) {
-    for (int j = mesh().js(FULL)+1; j <= mesh().je(FULL)-1; ++j) {
-        for (int i = mesh().is(FULL); i <= mesh().ie(FULL); ++i) {
-            dut(i, j) += (gd(timeIdx, i+1, j)-gd(timeIdx, i-1, j)+
-                          ghs(i+1, j)-ghs(i-1, j))*
-                         factorLon[j]*gdt(timeIdx, i, j);
+calcZonalWindPressureGradient(const State &state, int j) {
+    int r = reduceFactor[j];
+    if (r == 1) {
+        for (int i = regionIs; i <= regionIe; ++i) {
+            dut(i, j) += (state.gd(i+1, j)-state.gd(i-1, j)+state.ghsDx(i, j, 1))*
+                         factorLon[j]*state.gdt(i, j);
+        }
+        return;
+    }
+    // reduced rows
+    for (int i = regionIs; i <= regionIe; i += r) {
+        double tendency = (state.gd(i+r, j)-state.gd(i-1, j)+state.ghsDx(i, j, r))*
+                          factorLon[j]*state.gdt(i, j);
+        for (int k = 0; k < r; ++k) {
+            dut(i+k, j) += tendency;
         }
     }
 } // calcZonalWindPressureGradient
 
 /*
- *  Input: gd, ghs, gdt
- *  Output: dvt
+ *  Input: gd, ghsDy, gdt on rows j-1, j, j+1
+ *  Output: dvt on row j
  */
+template <class State>
 void BarotropicModel_A_ImplicitMidpoint::
-calcMeridionalWindPressureGradient(const TimeLevelIndex<2> &timeIdx) {
-    for (int j = mesh().js(FULL)+1; j <= mesh().je(FULL)-1; ++j) {
-        for (int i = mesh().is(FULL); i <= mesh().ie(FULL); ++i) {
-            dvt(i, j) += (gd(timeIdx, i, j+1)-gd(timeIdx, i, j-1)+
-                          ghs(i, j+1)-ghs(i, j-1))*
-                         factorLat[j]*cosLat[j]*gdt(timeIdx, i, j);
+calcMeridionalWindPressureGradient(const State &state, int j) {
+    int r = reduceFactor[j];
+    if (r == 1) {
+        for (int i = regionIs; i <= regionIe; ++i) {
+            dvt(i, j) += (state.gd(i, j+1)-state.gd(i, j-1)+state.ghsDy(i, j))*
+                         factorLatCos[j]*state.gdt(i, j);
+        }
+        return;
+    }
+    // reduced rows
+    for (int i = regionIs; i <= regionIe; i += r) {
+        double dy = 0.0;
+        for (int k = 0; k < r; ++k) {
+            dy += state.gd(i+k, j+1)-state.gd(i+k, j-1)+state.ghsDy(i+k, j);
+        }
+        double tendency = dy*factorLatCos[j]*state.gdt(i, j);
+        for (int k = 0; k < r; ++k) {
+            dvt(i+k, j) += tendency;
         }
     }
 } // calcMeridionalWindPressureGradient
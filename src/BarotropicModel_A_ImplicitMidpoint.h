@@ -2,31 +2,296 @@
 #define __BarotropicModel_A_ImplicitMidpoint__
 
 #include "BarotropicModel.h"
+#include "FieldExpression.h"
+#include "PyramidOutput.h"
+#include "StationOutput.h"
+#include "StateStream.h"
+#include "TaskGraph.h"
 
 namespace barotropic_model {
 
+class NestedRefinement;
+class ForcingStream;
+
 /**
  *  This barotropic model uses A-grid variable stagger configuration and
  *  implicit midpoint time integration method. The underlying numerical
  *  method is a finite difference, which can conserve the total energy
  *  and total mass exactly.
+ *
+ *  Only the old and new time levels are stored. The half-level variables are
+ *  computed on the fly inside the kernels, and the new level is seeded by the
+ *  rotation of the time level indices instead of copying. In the memory-lean
+ *  mode, the transformed variables are not stored either, which roughly
+ *  halves the resident set for very large grids at the cost of some extra
+ *  square roots.
+ *
+ *  In the reduced-grid mode, the cells on the high-latitude rows are merged
+ *  into blocks (of power-of-2 sizes), so that the zonal grid interval is not
+ *  less than half of the one on the Equator, which relaxes the time step
+ *  limit near the Poles. The variables are constant in each block, and the
+ *  tendencies are computed once for each block, where the zonal differences
+ *  span the block, and the neighbor rows are averaged over the block (a
+ *  conservative interpolation between rows with different block sizes).
+ *  Since this equals the block average of the tendencies on the full grid,
+ *  the total energy and mass are still conserved. The fields keep the full
+ *  rows, so the diagnostics and output need no change.
+ *
+ *  The tendencies, scratch buffers and coefficients are allocated from one
+ *  memory arena (optionally backed by huge pages), and first-touched by the
+ *  threads that compute on them.
+ *
+ *  Optionally, each fixed-point iteration runs as a graph of tasks on bands
+ *  of latitude rows (see TaskGraph) on a work-stealing pool, instead of one
+ *  OpenMP loop per stage with a barrier after each. The tasks declare the
+ *  bands they read and write, so e.g. the wind advection and Coriolis terms
+ *  (which only read the winds of the last iteration) run alongside the
+ *  geopotential depth update, and a band of the wind update starts as soon
+ *  as its neighbor bands are done. The wind advection then uses its own
+ *  flux buffers. The results are bitwise identical to the stage-by-stage
+ *  run, and the performance counters sample the stages only in the latter.
+ *
+ *  The terms that do not change between the iterations are cached: the
+ *  coefficient products are built in init(), and the differences of the
+ *  static surface geopotential in the pressure gradient are built at the
+ *  start of the first step, and rebuilt when the surface geopotential has
+ *  been changed through surfaceGeopotentialView(). The memory-lean mode
+ *  takes these differences on the fly instead.
+ *
+ *  The steps can also be confined to a region of the mesh (see setRegion()),
+ *  e.g. the patch of a nested refinement (see NestedRefinement), where the
+ *  ring of cells around the region holds the boundary conditions.
  */
 class BarotropicModel_A_ImplicitMidpoint : public BarotropicModel {
 protected:
-    Field<double> fu, fv;
+    // Stages of one step that are sampled by the performance counters.
+    enum PerfStageType {
+        PERF_TRANSFORM = 0, PERF_GEOPOTENTIAL_DEPTH_TENDENCY,
+        PERF_GEOPOTENTIAL_DEPTH_UPDATE, PERF_ZONAL_WIND_TENDENCY,
+        PERF_MERIDIONAL_WIND_TENDENCY, PERF_WIND_UPDATE, PERF_DIAGNOSTICS
+    };
+
+    MemoryArena arena;
+    MemoryArena::HugePageMode hugePageMode;
+    ArenaField dut, dvt, dgd;
+    ArenaField fu, fv;      //>! flux scratch buffers shared by all the kernels
+    ArenaField fuZonal, fvZonal, fuMeridional, fvMeridional; //>! for the task graph
+    ArenaField ghsDx;       //>! zonal differences of ghs across the cells or blocks
+    ArenaField ghsDy;       //>! meridional differences of ghs
+    bool leanMemory;
+    bool reducedGrid;
+    int maxIteration;       //>! maximum number of fixed-point iterations
+    int _numIteration;      //>! fixed-point iterations of the last step
+    bool verbose;           //>! print the energy and mass of each step
+    int numPyramidLevel;    //>! coarsened output levels (see PyramidOutput)
+    string stationFileName; //>! locations to sample (see StationOutput)
+    bool fieldOutput;       //>! write the full fields in run()
+    string outputPrefix;    //>! of the output files of run()
+    int outputFileIdx;      //>! of the full fields (-1 before the first output)
+    string streamName;      //>! shared memory of the live stream (see StateStream)
+    int streamDecimation;
+    int numTaskThread;      //>! threads of the task graph (0 for OpenMP stages)
+    int taskBandSize;       //>! latitude rows in one band of the task graph
+    ThreadPool *taskPool;
+    TaskGraph taskGraphs[2];//>! for the first and the later iterations
+    TimeLevelIndex<2> graphOldTimeIdx;
+    double graphDt;
+    int regionIs, regionIe; //>! cells updated by the steps (the whole mesh
+    int regionJs, regionJe; //>! by default, see setRegion())
+    NestedRefinement *nest; //>! refined patch stepped in run() (or NULL)
+    ForcingStream *forcingStream;   //>! applied along the steps in run() (or NULL)
+    Domain *sharedDomain;   //>! domain and mesh owned by others (or NULL)
+    Mesh *sharedMesh;
 
     double dlon, dlat;
-    vec cosLat, tanLat;
-    vec factorCor;  //>! Coriolis factor: 2*OMEGA*sin(lat)
-    vec factorCur;  //>! Curvature factor: tan(lat)/R
-    vec factorLon;  //>! 1/2/dlon/R/cos(lat)
-    vec factorLat;  //>! 1/2/dlat/R/cos(lat)
+    double *cosLat, *tanLat;
+    double *factorCor;  //>! Coriolis factor: 2*OMEGA*sin(lat)
+    double *factorCur;  //>! Curvature factor: tan(lat)/R
+    double *factorLon;  //>! 1/2/dlon/R/cos(lat)/(block size)
+    double *factorLat;  //>! 1/2/dlat/R/cos(lat)
+    double *factorLatCos;//>! factorLat*cos(lat)/(block size)
+    double *rowSum;     //>! scratch for the row sums of the diagnostics
+    int *reduceFactor;  //>! number of cells in one block on each row
+    double *blockWeight;//>! 1/(block size)
 
-    TimeLevelIndex<2> oldTimeIdx, halfTimeIdx, newTimeIdx;
+    TimeLevelIndex<2> newTimeIdx;
 public:
     BarotropicModel_A_ImplicitMidpoint();
     virtual ~BarotropicModel_A_ImplicitMidpoint();
 
+    /**
+     *  Turn on the memory-lean mode. This must be called before init().
+     */
+    void
+    setLeanMemory(bool leanMemory);
+
+    bool
+    isLeanMemory() const {
+        return leanMemory;
+    }
+
+    /**
+     *  Return whether the memory-lean mode can be turned off, which the
+     *  derived models without the transformed variables may not.
+     */
+    virtual bool
+    hasFullMemoryMode() const {
+        return true;
+    }
+
+    /**
+     *  Turn on the reduced-grid mode. This must be called before init().
+     */
+    void
+    setReducedGrid(bool reducedGrid);
+
+    bool
+    isReducedGrid() const {
+        return reducedGrid;
+    }
+
+    /**
+     *  Set the huge page mode of the memory arena. This must be called before
+     *  init().
+     */
+    void
+    setHugePageMode(MemoryArena::HugePageMode hugePageMode);
+
+    /**
+     *  Set the maximum number of fixed-point iterations in one step (8 by
+     *  default). A cheap coarse propagator can be made by a large time step
+     *  with few iterations (see PararealDriver).
+     */
+    void
+    setMaxIteration(int maxIteration);
+
+    /**
+     *  Run the iterations as task graphs on the given number of threads, with
+     *  bands of the given number of latitude rows (0 threads to turn off, by
+     *  default). This must be called before init().
+     */
+    void
+    setTaskGraph(int numThread, int bandSize = 4);
+
+    bool
+    isTaskGraph() const {
+        return numTaskThread > 0;
+    }
+
+    void
+    setVerbose(bool verbose) {
+        this->verbose = verbose;
+    }
+
+    /**
+     *  Also write the given number of coarsened levels in run() (none by
+     *  default).
+     */
+    void
+    setPyramidOutput(int numPyramidLevel);
+
+    /**
+     *  Also sample the stations and transects in the given file at every step
+     *  in run() into "<prefix>.stations" (none by default).
+     */
+    void
+    setStationOutput(const string &stationFileName) {
+        this->stationFileName = stationFileName;
+    }
+
+    /**
+     *  Turn the full-field output files of run() on or off (on by default),
+     *  e.g. off when only the station output is needed.
+     */
+    void
+    setFieldOutput(bool fieldOutput) {
+        this->fieldOutput = fieldOutput;
+    }
+
+    /**
+     *  Set the prefix of the output files of run() ("output" by default), e.g.
+     *  to tell the members of an ensemble apart.
+     */
+    void
+    setOutputPrefix(const string &outputPrefix) {
+        this->outputPrefix = outputPrefix;
+    }
+
+    /**
+     *  Also publish the state after every step in run() into the shared
+     *  memory stream of the given name, taking every decimation-th cell (no
+     *  stream by default).
+     */
+    void
+    setStateStream(const string &streamName, int streamDecimation = 1) {
+        this->streamName = streamName;
+        this->streamDecimation = streamDecimation;
+    }
+
+    /**
+     *  Use the given domain and mesh instead of creating them in init(), so
+     *  that the models of the same resolution can share one mesh. They must
+     *  be initialized and outlive the model, and this must be called before
+     *  init().
+     */
+    void
+    setSharedMesh(Domain &domain, Mesh &mesh);
+
+    /**
+     *  Only update the cells from (is, js) to (ie, je) in the steps, where the
+     *  ring of cells around them holds the boundary conditions, which must be
+     *  given on both time levels before each step. The region must not touch
+     *  the Poles or the zonal boundary. This must be called after init(), and
+     *  it is not supported in the reduced-grid and task-graph modes, or by
+     *  the semi-implicit model.
+     */
+    void
+    setRegion(int is, int ie, int js, int je);
+
+    bool
+    isRegional() const {
+        return regionJs != mesh().js(FULL);
+    }
+
+    /**
+     *  Step the given nested refinement along with the model in run(), and
+     *  also write its fields into "<prefix>.nest.%5s.nc" (none by default).
+     */
+    void
+    setNestedRefinement(NestedRefinement *nest) {
+        this->nest = nest;
+    }
+
+    /**
+     *  Apply the given forcing stream at the start and after every step in
+     *  run() (none by default).
+     */
+    void
+    setForcingStream(ForcingStream *forcingStream) {
+        this->forcingStream = forcingStream;
+    }
+
+    /**
+     *  Return the number of fixed-point iterations of the last step.
+     */
+    int
+    numIteration() const {
+        return _numIteration;
+    }
+
+    /**
+     *  Return the total energy of the current time level.
+     */
+    double
+    totalEnergy() const {
+        return calcTotalEnergy(oldTimeIdx, false);
+    }
+
+    double
+    totalMass() const {
+        return calcTotalMass(oldTimeIdx);
+    }
+
     virtual void
     init(TimeManager &timeManager, int numLon, int numLat);
 
@@ -36,31 +301,151 @@ public:
     virtual void
     run();
 
+    /**
+     *  Write the fields of the current time level into the output file of the
+     *  current time, as run() does at the start and after each step. This is
+     *  for the drivers that step the model by themselves, e.g. PararealDriver.
+     */
+    void
+    output();
+
     virtual void
     integrate(const TimeLevelIndex<2> &oldTimeIdx, double dt);
-private:
+protected:
+    /**
+     *  Calculate the total energy from the stored transformed variables, or
+     *  from the winds and geopotential depth (as in the memory-lean mode) if
+     *  the transformed variables of the time level are not computed yet.
+     */
     double
-    calcTotalEnergy(const TimeLevelIndex<2> &timeIdx) const;
+    calcTotalEnergy(const TimeLevelIndex<2> &timeIdx,
+                    bool useTransformed = true) const;
 
     double calcTotalMass(const TimeLevelIndex<2> &timeIdx) const;
 
-    void calcGeopotentialDepthTendency(const TimeLevelIndex<2> &timeIdx);
+    double
+    calcRowEnergy(const TimeLevelIndex<2> &timeIdx, int j,
+                  bool useTransformed) const;
+
+    /**
+     *  Return whether the steps read the cached differences of the surface
+     *  geopotential, which the memory-lean mode takes on the fly, and the
+     *  derived models with their own integrate() may not read at all.
+     */
+    virtual bool
+    hasSurfaceGeopotentialCache() const {
+        return !leanMemory;
+    }
+private:
+    /**
+     *  Average the variables over the blocks of the reduced rows.
+     */
+    void
+    projectToReducedGrid(const TimeLevelIndex<2> &timeIdx);
+
+    /**
+     *  Build the cached differences of the surface geopotential (if any),
+     *  and clear its change flag.
+     */
+    void
+    buildSurfaceGeopotentialCache();
+
+    /**
+     *  Set the estimated FLOPs of the stages from the cells of the region
+     *  and the memory mode.
+     */
+    void
+    estimateStageFlops();
+
+    // Rows of the tendencies (without the Poles), of the fluxes (also the
+    // rows next to a region), and of the region with its boundary ring.
+    int
+    tendencyJs() const {
+        return std::max(regionJs, mesh().js(FULL)+1);
+    }
+
+    int
+    tendencyJe() const {
+        return std::min(regionJe, mesh().je(FULL)-1);
+    }
+
+    int
+    fluxJs() const {
+        return std::max(regionJs-1, mesh().js(FULL)+1);
+    }
+
+    int
+    fluxJe() const {
+        return std::min(regionJe+1, mesh().je(FULL)-1);
+    }
+
+    int
+    ringJs() const {
+        return std::max(regionJs-1, mesh().js(FULL));
+    }
+
+    int
+    ringJe() const {
+        return std::min(regionJe+1, mesh().je(FULL));
+    }
+
+    void
+    updateGeopotentialDepth(const TimeLevelIndex<2> &oldTimeIdx, double dt,
+                            int j0, int j1);
+
+    void
+    updateWind(const TimeLevelIndex<2> &oldTimeIdx, double dt, int j0, int j1);
+
+    template <class State>
+    void buildTaskGraph(TaskGraph &graph, bool isFirstIteration,
+                        const State &gdState, const State &windState);
+
+    template <class State>
+    void calcGeopotentialDepthTendency(const State &state);
+
+    template <class State>
+    void calcGeopotentialDepthFlux(const State &state, int j);
+
+    void calcGeopotentialDepthTendency(int j);
+
+    void calcGeopotentialDepthPoleTendency();
+
+    template <class State>
+    void calcZonalWindTendency(const State &state);
+
+    template <class State>
+    void calcMeridionalWindTendency(const State &state);
 
-    void calcZonalWindTendency(const TimeLevelIndex<2> &timeIdx);
+    template <class State>
+    void calcZonalWindAdvectionFlux(const State &state, int j,
+                                    ArenaField &fluxLon, ArenaField &fluxLat);
 
-    void calcMeridionalWindTendency(const TimeLevelIndex<2> &timeIdx);
+    template <class State>
+    void calcZonalWindAdvection(const State &state, int j,
+                                const ArenaField &fluxLon,
+                                const ArenaField &fluxLat);
 
-    void calcZonalWindAdvection(const TimeLevelIndex<2> &timeIdx);
+    template <class State>
+    void calcMeridionalWindAdvectionFlux(const State &state, int j,
+                                         ArenaField &fluxLon,
+                                         ArenaField &fluxLat);
 
-    void calcMeridionalWindAdvection(const TimeLevelIndex<2> &timeIdx);
+    template <class State>
+    void calcMeridionalWindAdvection(const State &state, int j,
+                                     const ArenaField &fluxLon,
+                                     const ArenaField &fluxLat);
 
-    void calcZonalWindCoriolis(const TimeLevelIndex<2> &timeIdx);
+    template <class State>
+    void calcZonalWindCoriolis(const State &state, int j);
 
-    void calcMeridionalWindCoriolis(const TimeLevelIndex<2> &timeIdx);
+    template <class State>
+    void calcMeridionalWindCoriolis(const State &state, int j);
 
-    void calcZonalWindPressureGradient(const TimeLevelIndex<2> &timeIdx);
+    template <class State>
+    void calcZonalWindPressureGradient(const State &state, int j);
 
-    void calcMeridionalWindPressureGradient(const TimeLevelIndex<2> &timeIdx);
+    template <class State>
+    void calcMeridionalWindPressureGradient(const State &state, int j);
 };
 
 }
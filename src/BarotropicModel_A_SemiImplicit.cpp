@@ -0,0 +1,217 @@
+#include "BarotropicModel_A_SemiImplicit.h"
+
+namespace barotropic_model {
+
+BarotropicModel_A_SemiImplicit::BarotropicModel_A_SemiImplicit() {
+    leanMemory = true;
+    offCentering = 0.55;
+    referenceDepth = 0.0;
+    hasOldTendency = false;
+    REPORT_ONLINE;
+}
+
+BarotropicModel_A_SemiImplicit::~BarotropicModel_A_SemiImplicit() {
+    REPORT_OFFLINE;
+}
+
+void BarotropicModel_A_SemiImplicit::
+setOffCentering(double offCentering) {
+    if (offCentering < 0.5 || offCentering > 1.0) {
+        REPORT_ERROR("Off-centering weight must be in [0.5, 1]!");
+    }
+    this->offCentering = offCentering;
+} // setOffCentering
+
+void BarotropicModel_A_SemiImplicit::
+setReferenceDepth(double referenceDepth) {
+    if (referenceDepth <= 0) {
+        REPORT_ERROR("Reference geopotential depth must be positive!");
+    }
+    this->referenceDepth = referenceDepth;
+} // setReferenceDepth
+
+void BarotropicModel_A_SemiImplicit::
+init(TimeManager &timeManager, int numLon, int numLat) {
+    if (reducedGrid) {
+        REPORT_ERROR("Semi-implicit model does not support reduced grid!");
+    }
+    // Note: No transformed variable is used.
+    if (!leanMemory) {
+        REPORT_NOTICE("Semi-implicit model has no full memory mode, so the " <<
+                      "memory-lean mode is used.");
+        leanMemory = true;
+    }
+    BarotropicModel_A_ImplicitMidpoint::init(timeManager, numLon, numLat);
+    extraArena.init(6*ArenaField::numByte(mesh()), hugePageMode);
+    dutOld.create(mesh(), extraArena);
+    dvtOld.create(mesh(), extraArena);
+    dgdOld.create(mesh(), extraArena);
+    us.create(mesh(), extraArena);
+    vs.create(mesh(), extraArena);
+    rhs.create(mesh(), extraArena);
+    helmholtz.init(mesh(), cosLat);
+    // Estimate the FLOPs of the stages as estimateStageFlops(), where the
+    // two FFTs of a row take 5N*log2(N) FLOPs each, and the energy and mass
+    // are only summed once a step.
+    double numCell = double(numLon)*numLat;
+    perfExplicit = perf.addStage("explicit tendency", 81*numCell);
+    perfSolve = perf.addStage("Helmholtz solve",
+                              (10*log2(double(numLon))+10)*numCell);
+    perfUpdate = perf.addStage("semi-implicit update", 11*numCell);
+    perf.setStageFlops(PERF_DIAGNOSTICS, 11*numCell);
+} // init
+
+void BarotropicModel_A_SemiImplicit::
+integrate(const TimeLevelIndex<2> &oldTimeIdx, double dt) {
+    newTimeIdx = oldTimeIdx+1;
+    if (referenceDepth == 0.0) {
+        for (int j = mesh().js(FULL); j <= mesh().je(FULL); ++j) {
+            for (int i = mesh().is(FULL); i <= mesh().ie(FULL); ++i) {
+                referenceDepth = std::max(referenceDepth, gd(oldTimeIdx, i, j));
+            }
+        }
+    }
+    double beta = offCentering;
+    double depth = referenceDepth;
+    // Get the old total energy and mass.
+    double e0, m0;
+    {
+        PerfStage stage(perf, PERF_DIAGNOSTICS);
+        e0 = calcTotalEnergy(oldTimeIdx, false);
+        m0 = calcTotalMass(oldTimeIdx);
+    }
+    if (verbose) {
+        cout << "energy: ";
+        cout << std::fixed << setw(20) << setprecision(2) << e0 << "  ";
+        cout << "mass: ";
+        cout << setw(20) << setprecision(2) << m0 << endl;
+    }
+    {
+        PerfStage stage(perf, perfExplicit);
+        calcExplicitTendency(oldTimeIdx, depth);
+        // The surface geopotential is only read above, and its halo has been
+        // exchanged by step(), so it is up to date until it is changed again.
+        ghsChanged = false;
+        // Extrapolate the explicit tendencies to the half level (the first
+        // step is forward).
+        double w0 = hasOldTendency ? 1.5 : 1.0;
+        double w1 = hasOldTendency ? -0.5 : 0.0;
+        // Get the new winds without the implicit pressure gradient, and the
+        // fluxes of the linearized divergence.
+        #pragma omp parallel for
+        for (int j = mesh().js(FULL)+1; j <= mesh().je(FULL)-1; ++j) {
+            for (int i = mesh().is(FULL); i <= mesh().ie(FULL); ++i) {
+                double dgdx = (gd(oldTimeIdx, i+1, j)-gd(oldTimeIdx, i-1, j))*factorLon[j];
+                double dgdy = (gd(oldTimeIdx, i, j+1)-gd(oldTimeIdx, i, j-1))*factorLat[j]*cosLat[j];
+                us(i, j) = u(oldTimeIdx, i, j)-
+                    dt*(w0*dut(i, j)+w1*dutOld(i, j)+(1-beta)*dgdx);
+                vs(i, j) = v(oldTimeIdx, i, j)-
+                    dt*(w0*dvt(i, j)+w1*dvtOld(i, j)+(1-beta)*dgdy);
+            }
+            us(mesh().is(FULL)-1, j) = us(mesh().ie(FULL), j);
+            us(mesh().ie(FULL)+1, j) = us(mesh().is(FULL), j);
+            vs(mesh().is(FULL)-1, j) = vs(mesh().ie(FULL), j);
+            vs(mesh().ie(FULL)+1, j) = vs(mesh().is(FULL), j);
+            for (int i = mesh().is(FULL)-1; i <= mesh().ie(FULL)+1; ++i) {
+                fu(i, j) = depth*((1-beta)*u(oldTimeIdx, i, j)+beta*us(i, j));
+                fv(i, j) = depth*((1-beta)*v(oldTimeIdx, i, j)+beta*vs(i, j))*cosLat[j];
+            }
+        }
+        calcDivergence(rhs);
+        #pragma omp parallel for
+        for (int j = mesh().js(FULL); j <= mesh().je(FULL); ++j) {
+            for (int i = mesh().is(FULL); i <= mesh().ie(FULL); ++i) {
+                rhs(i, j) = gd(oldTimeIdx, i, j)-
+                    dt*(w0*dgd(i, j)+w1*dgdOld(i, j)+rhs(i, j));
+            }
+        }
+        // Keep the tendencies for the next extrapolation.
+        std::swap(dut, dutOld);
+        std::swap(dvt, dvtOld);
+        std::swap(dgd, dgdOld);
+        hasOldTendency = true;
+    }
+    // Solve the new geopotential depth.
+    {
+        PerfStage stage(perf, perfSolve);
+        helmholtz.solve(pow(beta*dt, 2)*depth, rhs, rhs);
+    }
+    // Add the implicit pressure gradient to the winds.
+    {
+        PerfStage stage(perf, perfUpdate);
+        level(gd, newTimeIdx) = level(rhs);
+        #pragma omp parallel for
+        for (int j = mesh().js(FULL)+1; j <= mesh().je(FULL)-1; ++j) {
+            for (int i = mesh().is(FULL); i <= mesh().ie(FULL); ++i) {
+                u(newTimeIdx, i, j) = us(i, j)-
+                    dt*beta*(rhs(i+1, j)-rhs(i-1, j))*factorLon[j];
+                v(newTimeIdx, i, j) = vs(i, j)-
+                    dt*beta*(rhs(i, j+1)-rhs(i, j-1))*factorLat[j]*cosLat[j];
+            }
+        }
+        int js = mesh().js(FULL), jn = mesh().je(FULL);
+        for (int i = mesh().is(FULL); i <= mesh().ie(FULL); ++i) {
+            u(newTimeIdx, i, js) = u(oldTimeIdx, i, js);
+            u(newTimeIdx, i, jn) = u(oldTimeIdx, i, jn);
+            v(newTimeIdx, i, js) = v(oldTimeIdx, i, js);
+            v(newTimeIdx, i, jn) = v(oldTimeIdx, i, jn);
+        }
+        BoundaryExchange::run(newTimeIdx, {&u, &v});
+    }
+} // integrate
+
+void BarotropicModel_A_SemiImplicit::
+calcExplicitTendency(const TimeLevelIndex<2> &timeIdx, double depth) {
+    // The divergence of the residual mass fluxes.
+    #pragma omp parallel for
+    for (int j = mesh().js(FULL)+1; j <= mesh().je(FULL)-1; ++j) {
+        for (int i = mesh().is(FULL)-1; i <= mesh().ie(FULL)+1; ++i) {
+            double gdr = gd(timeIdx, i, j)-depth;
+            fu(i, j) = gdr*u(timeIdx, i, j);
+            fv(i, j) = gdr*v(timeIdx, i, j)*cosLat[j];
+        }
+    }
+    calcDivergence(dgd);
+    // The advection, Coriolis and curvature, and surface geopotential.
+    #pragma omp parallel for
+    for (int j = mesh().js(FULL)+1; j <= mesh().je(FULL)-1; ++j) {
+        for (int i = mesh().is(FULL); i <= mesh().ie(FULL); ++i) {
+            double u0 = u(timeIdx, i, j);
+            double v0 = v(timeIdx, i, j);
+            double dudx = (u(timeIdx, i+1, j)-u(timeIdx, i-1, j))*factorLon[j];
+            double dvdx = (v(timeIdx, i+1, j)-v(timeIdx, i-1, j))*factorLon[j];
+            double dudy = (u(timeIdx, i, j+1)-u(timeIdx, i, j-1))*factorLat[j]*cosLat[j];
+            double dvdy = (v(timeIdx, i, j+1)-v(timeIdx, i, j-1))*factorLat[j]*cosLat[j];
+            double f = factorCor[j]+u0*factorCur[j];
+            dut(i, j) = u0*dudx+v0*dudy-f*v0+
+                        (ghs(i+1, j)-ghs(i-1, j))*factorLon[j];
+            dvt(i, j) = u0*dvdx+v0*dvdy+f*u0+
+                        (ghs(i, j+1)-ghs(i, j-1))*factorLat[j]*cosLat[j];
+        }
+    }
+} // calcExplicitTendency
+
+void BarotropicModel_A_SemiImplicit::
+calcDivergence(ArenaField &div) {
+    #pragma omp parallel for
+    for (int j = mesh().js(FULL)+1; j <= mesh().je(FULL)-1; ++j) {
+        for (int i = mesh().is(FULL); i <= mesh().ie(FULL); ++i) {
+            div(i, j) = (fu(i+1, j)-fu(i-1, j))*factorLon[j]+
+                        (fv(i, j+1)-fv(i, j-1))*factorLat[j];
+        }
+    }
+    int js = mesh().js(FULL), jn = mesh().je(FULL);
+    double divs = 0.0, divn = 0.0;
+    for (int i = mesh().is(FULL); i <= mesh().ie(FULL); ++i) {
+        divs += fv(i, js+1);
+        divn -= fv(i, jn-1);
+    }
+    divs *= factorLat[js]/mesh().numGrid(0, FULL);
+    divn *= factorLat[jn]/mesh().numGrid(0, FULL);
+    for (int i = mesh().is(FULL); i <= mesh().ie(FULL); ++i) {
+        div(i, js) = divs;
+        div(i, jn) = divn;
+    }
+} // calcDivergence
+
+} // barotropic_model
@@ -0,0 +1,114 @@
+#ifndef __BarotropicModel_A_SemiImplicit__
+#define __BarotropicModel_A_SemiImplicit__
+
+#include "BarotropicModel_A_ImplicitMidpoint.h"
+#include "HelmholtzSolver.h"
+
+namespace barotropic_model {
+
+/**
+ *  This barotropic model uses the A-grid finite differences of the implicit
+ *  midpoint model, but integrates the equations in the advective form
+ *
+ *  𝜕u     u  𝜕u   v 𝜕u                     1    𝜕𝝓+𝝓ˢ
+ *  -- = - ------ -- - - -- + (f + u/a tan𝜑) v - ------ -----,
+ *  𝜕t     a cos𝜑 𝜕𝛌   a 𝜕𝜑                     a cos𝜑   𝜕𝛌
+ *
+ *  𝜕v     u  𝜕v   v 𝜕v                     1 𝜕𝝓+𝝓ˢ
+ *  -- = - ------ -- - - -- - (f + u/a tan𝜑) u - - -----,
+ *  𝜕t     a cos𝜑 𝜕𝛌   a 𝜕𝜑                     a  𝜕𝜑
+ *
+ *  𝜕𝝓        1    𝜕𝝓u   𝜕𝝓v cos𝜑
+ *  -- = - ------ (---- + --------),
+ *  𝜕t     a cos𝜑   𝜕𝛌       𝜕𝜑
+ *
+ *  with a semi-implicit scheme. The gravity-wave terms, i.e. the pressure
+ *  gradient of 𝝓 and the divergence term linearized about a reference depth
+ *  𝝓₀ (𝝓₀∇·V), are off-centered Crank-Nicolson with weight 𝛃, and the other
+ *  terms are second-order Adams-Bashforth. Eliminating the new winds gives
+ *  one Helmholtz problem for the new geopotential depth each step
+ *
+ *      𝝓ⁿ⁺¹ - (𝛃Δt)²𝝓₀ ∇·∇𝝓ⁿ⁺¹ = R,
+ *
+ *  which is solved directly by HelmholtzSolver. The time step is then only
+ *  limited by the advection instead of the gravity waves, and there is no
+ *  fixed-point iteration. The mass is conserved to round-off, while the energy
+ *  is not, so its drift should be watched in the diagnostics.
+ *
+ *  The reference depth is the maximum of the initial geopotential depth by
+ *  default, which keeps the explicit residual of the divergence stable.
+ *
+ *  Note: The reduced-grid mode is not supported, and the memory-lean mode is
+ *        always on, since no transformed variable is used (turning it off
+ *        is reported and ignored).
+ */
+class BarotropicModel_A_SemiImplicit : public BarotropicModel_A_ImplicitMidpoint {
+protected:
+    HelmholtzSolver helmholtz;
+    MemoryArena extraArena;
+    ArenaField dutOld, dvtOld, dgdOld;  //>! explicit tendencies of the last step
+    ArenaField us, vs;                  //>! explicit estimates of the new winds
+    ArenaField rhs;                     //>! Helmholtz right hand side and solution
+    double offCentering;                //>! implicit weight 𝛃 of the gravity waves
+    double referenceDepth;              //>! 𝝓₀ (set at the first step if zero)
+    bool hasOldTendency;
+    int perfExplicit, perfSolve, perfUpdate;
+public:
+    BarotropicModel_A_SemiImplicit();
+    virtual ~BarotropicModel_A_SemiImplicit();
+
+    /**
+     *  Set the implicit weight of the gravity-wave terms (0.55 by default).
+     *  A weight above 0.5 damps the gravity waves, which is needed for the
+     *  large time steps, since the explicit Coriolis terms act on them.
+     */
+    void
+    setOffCentering(double offCentering);
+
+    /**
+     *  Set the reference geopotential depth of the linearized divergence.
+     */
+    void
+    setReferenceDepth(double referenceDepth);
+
+    virtual bool
+    hasFullMemoryMode() const {
+        return false;
+    }
+
+    virtual void
+    init(TimeManager &timeManager, int numLon, int numLat);
+
+    virtual void
+    integrate(const TimeLevelIndex<2> &oldTimeIdx, double dt);
+protected:
+    /**
+     *  The surface geopotential gradient is an explicit tendency, which is
+     *  taken once per step, so it is not cached.
+     */
+    virtual bool
+    hasSurfaceGeopotentialCache() const {
+        return false;
+    }
+private:
+    /**
+     *  Calculate the explicit tendencies (advection, Coriolis, curvature,
+     *  surface geopotential gradient and nonlinear divergence residual) on
+     *  the given time level into dut, dvt and dgd. As in the implicit
+     *  midpoint model, they are the negative tendencies, and dut and dvt
+     *  are of u and v here.
+     */
+    void
+    calcExplicitTendency(const TimeLevelIndex<2> &timeIdx, double depth);
+
+    /**
+     *  Calculate the divergence of the fluxes in fu and fv (fv contains
+     *  cos(lat)) into the given field, as the A-grid mass flux divergence.
+     */
+    void
+    calcDivergence(ArenaField &div);
+}; // BarotropicModel_A_SemiImplicit
+
+} // barotropic_model
+
+#endif // __BarotropicModel_A_SemiImplicit__
@@ -7,6 +7,9 @@ namespace barotropic_model {
 
 class BarotropicModel_C_ImplicitMidpoint : public BarotropicModel {
 protected:
+    Field<double> dut, dvt, dgd;
+    Field<double> gdu, gdv;
+
     double dlon, dlat;
     vec cosLatFull, cosLatHalf, tanLat;
     vec factorCor;      //>! Coriolis factor: 2*OMEGA*sin(lat)
@@ -15,14 +18,14 @@ protected:
     vec factorLatFull;  //>! 1/2/dlat/R/cos(lat) on full meridional grids
     vec factorLatHalf;  //>! 1/2/dlat/R/cos(lat) on half meridional grids
     
-    TimeLevelIndex<2> oldTimeIdx, halfTimeIdx, newTimeIdx;
+    TimeLevelIndex<2> halfTimeIdx, newTimeIdx;
 public:
     BarotropicModel_C_ImplicitMidpoint();
     virtual ~BarotropicModel_C_ImplicitMidpoint();
 
     virtual void init(TimeManager &timeManager, int numLon, int numLat);
 
-    virtual void input(const std::string &fileName) {}
+    virtual void input(const std::string &) {}
 
     virtual void run();
 
@@ -0,0 +1,34 @@
+#include "BoundaryExchange.h"
+
+namespace barotropic_model {
+
+void BoundaryExchange::
+run(const TimeLevelIndex<2> &timeIdx,
+    std::initializer_list<Field<double, 2>*> fields) {
+    if (fields.size() == 0) return;
+    const Mesh &mesh = static_cast<const Mesh&>((*fields.begin())->mesh());
+    #pragma omp parallel for
+    for (int j = mesh.js(FULL); j <= mesh.je(FULL); ++j) {
+        for (Field<double, 2> *field : fields) {
+            if (j <= mesh.je(field->gridType(1))) {
+                applyRow(*field, timeIdx, j);
+            }
+        }
+    }
+} // run
+
+void BoundaryExchange::
+run(std::initializer_list<Field<double>*> fields) {
+    if (fields.size() == 0) return;
+    const Mesh &mesh = static_cast<const Mesh&>((*fields.begin())->mesh());
+    #pragma omp parallel for
+    for (int j = mesh.js(FULL); j <= mesh.je(FULL); ++j) {
+        for (Field<double> *field : fields) {
+            if (j <= mesh.je(field->gridType(1))) {
+                applyRow(*field, j);
+            }
+        }
+    }
+} // run
+
+} // barotropic_model
@@ -0,0 +1,52 @@
+#ifndef __BoundaryExchange__
+#define __BoundaryExchange__
+
+#include "barotropic_model_commons.h"
+
+namespace barotropic_model {
+
+/**
+ *  This class updates the zonal periodic halo columns of a set of fields in
+ *  one pass over the latitude rows, instead of one pass (and one thread
+ *  synchronization) for each field. The rows can also be updated one by one
+ *  from the loops that produce them (see evaluate in FieldExpression.h), so
+ *  that no separate pass is needed at all.
+ *
+ *  Note: Only the halo columns next to the cells are updated, since the
+ *        stencils of the model reach no further.
+ */
+class BoundaryExchange {
+public:
+    static void
+    run(const TimeLevelIndex<2> &timeIdx,
+        std::initializer_list<Field<double, 2>*> fields);
+
+    static void
+    run(std::initializer_list<Field<double>*> fields);
+
+    static void
+    applyRow(Field<double, 2> &field, const TimeLevelIndex<2> &timeIdx, int j) {
+        const Mesh &mesh = static_cast<const Mesh&>(field.mesh());
+        int is = mesh.is(field.gridType(0)), ie = mesh.ie(field.gridType(0));
+        field(timeIdx, is-1, j) = field(timeIdx, ie, j);
+        field(timeIdx, ie+1, j) = field(timeIdx, is, j);
+    }
+
+    /**
+     *  Update the halo of a static field (e.g. the surface geopotential) only
+     *  where it is stale, so that the field is not written when it has not
+     *  changed, and stays shared with the forked processes (see
+     *  EnsembleFork).
+     */
+    static void
+    applyRow(Field<double> &field, int j) {
+        const Mesh &mesh = static_cast<const Mesh&>(field.mesh());
+        int is = mesh.is(field.gridType(0)), ie = mesh.ie(field.gridType(0));
+        if (field(is-1, j) != field(ie, j)) field(is-1, j) = field(ie, j);
+        if (field(ie+1, j) != field(is, j)) field(ie+1, j) = field(is, j);
+    }
+}; // BoundaryExchange
+
+} // barotropic_model
+
+#endif // __BoundaryExchange__
@@ -0,0 +1,125 @@
+#include "EnsembleFork.h"
+#include "BoundaryExchange.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace barotropic_model {
+
+EnsembleFork::EnsembleFork() {
+    numMember = 1;
+    maxNumProcess = 0;
+    REPORT_ONLINE;
+}
+
+EnsembleFork::~EnsembleFork() {
+    REPORT_OFFLINE;
+}
+
+void EnsembleFork::
+setNumMember(int numMember) {
+    if (numMember < 1) {
+        REPORT_ERROR("Member number must be positive!");
+    }
+    this->numMember = numMember;
+} // setNumMember
+
+void EnsembleFork::
+setMaxNumProcess(int maxNumProcess) {
+    if (maxNumProcess < 0) {
+        REPORT_ERROR("Process number must not be negative!");
+    }
+    this->maxNumProcess = maxNumProcess;
+} // setMaxNumProcess
+
+int EnsembleFork::
+run(BarotropicModel_A_ImplicitMidpoint &model, const MemberHook &perturb,
+    const MemberHook &integrate) const {
+    typedef std::chrono::steady_clock Clock;
+    if (model.isTaskGraph()) {
+        REPORT_ERROR("Ensemble fork does not support the task graph mode!");
+    }
+    // Flush the buffered output, or the members would write it again.
+    cout.flush();
+    std::cerr.flush();
+    fflush(NULL);
+    int maxNumRunning = maxNumProcess;
+    if (maxNumRunning == 0) {
+        maxNumRunning = 1;
+#ifdef _OPENMP
+        maxNumRunning = omp_get_max_threads();
+#endif
+    }
+    int numRunning = 0, numFailed = 0;
+    double forkTime = 0;
+    auto waitOne = [&] () {
+        int status;
+        pid_t pid = wait(&status);
+        if (pid < 0) {
+            REPORT_ERROR("Failed to wait for the ensemble members!");
+        }
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            REPORT_WARNING("Ensemble member process " << pid << " failed!");
+            ++numFailed;
+        }
+        --numRunning;
+    };
+    for (int m = 0; m < numMember; ++m) {
+        if (numRunning == maxNumRunning) {
+            waitOne();
+        }
+        Clock::time_point t0 = Clock::now();
+        pid_t pid = fork();
+        if (pid == 0) {
+            // In the member, which exits without running the destructors of
+            // the objects that belong to the calling process.
+#ifdef _OPENMP
+            omp_set_num_threads(1);
+#endif
+            int status = 0;
+            try {
+                perturb(model, m);
+                integrate(model, m);
+            } catch (...) {
+                status = 1;
+            }
+            cout.flush();
+            std::cerr.flush();
+            fflush(NULL);
+            _exit(status);
+        } else if (pid < 0) {
+            REPORT_ERROR("Failed to fork ensemble member " << m << "!");
+        }
+        forkTime += std::chrono::duration<double>(Clock::now()-t0).count();
+        ++numRunning;
+    }
+    REPORT_NOTICE("Forked " << numMember << " ensemble members in " <<
+                  forkTime*1.0e3 << " ms.");
+    while (numRunning > 0) {
+        waitOne();
+    }
+    return numFailed;
+} // run
+
+void EnsembleFork::
+perturbGeopotentialDepth(BarotropicModel &model, int memberIdx,
+                         double amplitude) {
+    const Mesh &mesh = model.mesh();
+    const TimeLevelIndex<2> &timeIdx = model.currentTimeIdx();
+    Field<double, 2> &gd = model.geopotentialDepth();
+    std::mt19937 rng(memberIdx+1);
+    std::uniform_real_distribution<double> dist(-amplitude, amplitude);
+    for (int j = mesh.js(FULL)+1; j <= mesh.je(FULL)-1; ++j) {
+        for (int i = mesh.is(FULL); i <= mesh.ie(FULL); ++i) {
+            gd(timeIdx, i, j) *= 1+dist(rng);
+        }
+    }
+    BoundaryExchange::run(timeIdx, {&gd});
+} // perturbGeopotentialDepth
+
+} // barotropic_model
@@ -0,0 +1,67 @@
+#ifndef __EnsembleFork__
+#define __EnsembleFork__
+
+#include "BarotropicModel_A_ImplicitMidpoint.h"
+#include <functional>
+
+namespace barotropic_model {
+
+/**
+ *  This class launches the members of a perturbed ensemble from one model
+ *  that has been spun up, instead of spinning up or reading the state in
+ *  every member. Each member is a forked process, so it starts from the
+ *  state of the model at no cost, and shares all the memory of the model
+ *  copy-on-write: the mesh, the coefficients and the surface geopotential
+ *  (with its cached differences) are never written by the steps, so they are
+ *  stored once for the whole ensemble, and only the pages of the prognostic
+ *  and scratch fields are copied into the members.
+ *
+ *  A member applies the perturbation hook to the model, integrates it by the
+ *  integration hook (e.g. run() with its own output prefix) and exits, while
+ *  the calling process waits for all the members and keeps its model intact.
+ *
+ *  Note: The threads of the calling process do not exist in the forked
+ *        processes, and the OpenMP runtime (e.g. of GCC) can not start new
+ *        ones there once it has run a parallel region. So each member runs
+ *        on one thread, and the members run concurrently instead, as many
+ *        as the threads of the calling process by default. For the same
+ *        reason, the task graph mode is not supported.
+ */
+class EnsembleFork {
+public:
+    typedef std::function<void (BarotropicModel_A_ImplicitMidpoint &model,
+                                int memberIdx)> MemberHook;
+protected:
+    int numMember;
+    int maxNumProcess;      //>! members running at once (0 for the threads)
+public:
+    EnsembleFork();
+    virtual ~EnsembleFork();
+
+    void
+    setNumMember(int numMember);
+
+    void
+    setMaxNumProcess(int maxNumProcess);
+
+    /**
+     *  Fork the members from the current state of the model, which has been
+     *  initialized (e.g. by initialize()) and spun up, and wait for them.
+     *  Return the number of members that fail.
+     */
+    int
+    run(BarotropicModel_A_ImplicitMidpoint &model, const MemberHook &perturb,
+        const MemberHook &integrate) const;
+
+    /**
+     *  Perturb the geopotential depth of the current time level by uniform
+     *  random noise of the given relative amplitude, seeded by the member.
+     */
+    static void
+    perturbGeopotentialDepth(BarotropicModel &model, int memberIdx,
+                             double amplitude);
+}; // EnsembleFork
+
+} // barotropic_model
+
+#endif // __EnsembleFork__
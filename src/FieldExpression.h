@@ -0,0 +1,479 @@
+#ifndef __FieldExpression__
+#define __FieldExpression__
+
+#include "ArenaField.h"
+#include "BoundaryExchange.h"
+
+namespace barotropic_model {
+
+/**
+ *  These classes build lazily evaluated expressions on the cell-centered
+ *  fields, so that elementwise field arithmetic like
+ *
+ *      level(ut, newTimeIdx) = level(ut, oldTimeIdx)-dt*level(dut);
+ *
+ *  is compiled into one loop over the cells, instead of one memory pass for
+ *  each operation. Several assignments can also be fused into one loop by
+ *
+ *      evaluate(assign(level(gd, newTimeIdx), level(gd, oldTimeIdx)-dt*level(dgd)),
+ *               assign(level(gdt, newTimeIdx), sqrt(level(gd, newTimeIdx))));
+ *
+ *  where the assignments are done in order at each cell, so a later one can
+ *  read the cell just written by an earlier one.
+ *
+ *  The loop runs over the cells without halo (parallelized over the latitude
+ *  rows), and the halo columns of each assigned field are written right after
+ *  its row is done, so the boundary conditions need no separate pass.
+ *
+ *  Only pointwise operations are supported, so the stencils of the tendency
+ *  kernels are still written by hand.
+ */
+template <class E>
+struct FieldExpression {
+    const E&
+    self() const {
+        return static_cast<const E&>(*this);
+    }
+}; // FieldExpression
+
+// -----------------------------------------------------------------------------
+// Terminals.
+
+/**
+ *  One time level of a two-level field.
+ */
+template <class FieldType>
+class TimeLevelTerminal : public FieldExpression<TimeLevelTerminal<FieldType> > {
+    FieldType *field;
+    TimeLevelIndex<2> timeIdx;
+public:
+    TimeLevelTerminal(FieldType &field, const TimeLevelIndex<2> &timeIdx)
+    : field(&field), timeIdx(timeIdx) {}
+
+    TimeLevelTerminal(const TimeLevelTerminal &other)
+    : field(other.field), timeIdx(other.timeIdx) {}
+
+    double
+    operator()(int i, int j) const {
+        return (*field)(timeIdx, i, j);
+    }
+
+    double&
+    at(int i, int j) const {
+        return (*field)(timeIdx, i, j);
+    }
+
+    const Mesh&
+    mesh() const {
+        return static_cast<const Mesh&>(field->mesh());
+    }
+
+    void
+    applyBndCond(int j) const {
+        BoundaryExchange::applyRow(*field, timeIdx, j);
+    }
+
+    template <class E>
+    TimeLevelTerminal&
+    operator=(const FieldExpression<E> &expr);
+
+    TimeLevelTerminal&
+    operator=(const TimeLevelTerminal &other);
+
+    TimeLevelTerminal&
+    operator=(double value);
+}; // TimeLevelTerminal
+
+/**
+ *  A single-level field, e.g. the surface geopotential.
+ */
+template <class FieldType>
+class SingleLevelTerminal : public FieldExpression<SingleLevelTerminal<FieldType> > {
+    FieldType *field;
+public:
+    SingleLevelTerminal(FieldType &field) : field(&field) {}
+
+    SingleLevelTerminal(const SingleLevelTerminal &other) : field(other.field) {}
+
+    double
+    operator()(int i, int j) const {
+        return (*field)(i, j);
+    }
+
+    double&
+    at(int i, int j) const {
+        return (*field)(i, j);
+    }
+
+    const Mesh&
+    mesh() const {
+        return static_cast<const Mesh&>(field->mesh());
+    }
+
+    void
+    applyBndCond(int j) const {
+        BoundaryExchange::applyRow(*field, j);
+    }
+
+    template <class E>
+    SingleLevelTerminal&
+    operator=(const FieldExpression<E> &expr);
+
+    SingleLevelTerminal&
+    operator=(const SingleLevelTerminal &other);
+
+    SingleLevelTerminal&
+    operator=(double value);
+}; // SingleLevelTerminal
+
+/**
+ *  A tendency or scratch buffer in the memory arena. Its halo is never read,
+ *  so there is no boundary condition to apply.
+ */
+template <class FieldType>
+class ArenaTerminal : public FieldExpression<ArenaTerminal<FieldType> > {
+    FieldType *field;
+public:
+    ArenaTerminal(FieldType &field) : field(&field) {}
+
+    ArenaTerminal(const ArenaTerminal &other) : field(other.field) {}
+
+    double
+    operator()(int i, int j) const {
+        return (*field)(i, j);
+    }
+
+    double&
+    at(int i, int j) const {
+        return (*field)(i, j);
+    }
+
+    const Mesh&
+    mesh() const {
+        return field->mesh();
+    }
+
+    void
+    applyBndCond(int j) const {}
+
+    template <class E>
+    ArenaTerminal&
+    operator=(const FieldExpression<E> &expr);
+
+    ArenaTerminal&
+    operator=(const ArenaTerminal &other);
+
+    ArenaTerminal&
+    operator=(double value);
+}; // ArenaTerminal
+
+class ScalarTerminal : public FieldExpression<ScalarTerminal> {
+    double value;
+public:
+    ScalarTerminal(double value) : value(value) {}
+
+    double
+    operator()(int, int) const {
+        return value;
+    }
+}; // ScalarTerminal
+
+inline TimeLevelTerminal<Field<double, 2> >
+level(Field<double, 2> &field, const TimeLevelIndex<2> &timeIdx) {
+    return TimeLevelTerminal<Field<double, 2> >(field, timeIdx);
+}
+
+inline TimeLevelTerminal<const Field<double, 2> >
+level(const Field<double, 2> &field, const TimeLevelIndex<2> &timeIdx) {
+    return TimeLevelTerminal<const Field<double, 2> >(field, timeIdx);
+}
+
+inline SingleLevelTerminal<Field<double> >
+level(Field<double> &field) {
+    return SingleLevelTerminal<Field<double> >(field);
+}
+
+inline SingleLevelTerminal<const Field<double> >
+level(const Field<double> &field) {
+    return SingleLevelTerminal<const Field<double> >(field);
+}
+
+inline ArenaTerminal<ArenaField>
+level(ArenaField &field) {
+    return ArenaTerminal<ArenaField>(field);
+}
+
+inline ArenaTerminal<const ArenaField>
+level(const ArenaField &field) {
+    return ArenaTerminal<const ArenaField>(field);
+}
+
+// -----------------------------------------------------------------------------
+// Operations.
+
+struct PlusOperation {
+    static double apply(double a, double b) { return a+b; }
+};
+
+struct MinusOperation {
+    static double apply(double a, double b) { return a-b; }
+};
+
+struct MultiplyOperation {
+    static double apply(double a, double b) { return a*b; }
+};
+
+struct DivideOperation {
+    static double apply(double a, double b) { return a/b; }
+};
+
+struct NegateOperation {
+    static double apply(double a) { return -a; }
+};
+
+// Note: Keep the math function visible beside the overload for expressions.
+using std::sqrt;
+
+struct SqrtOperation {
+    static double apply(double a) { return sqrt(a); }
+};
+
+template <class L, class R, class Operation>
+class BinaryExpression : public FieldExpression<BinaryExpression<L, R, Operation> > {
+    L left;
+    R right;
+public:
+    BinaryExpression(const L &left, const R &right)
+    : left(left), right(right) {}
+
+    double
+    operator()(int i, int j) const {
+        return Operation::apply(left(i, j), right(i, j));
+    }
+}; // BinaryExpression
+
+template <class E, class Operation>
+class UnaryExpression : public FieldExpression<UnaryExpression<E, Operation> > {
+    E expr;
+public:
+    UnaryExpression(const E &expr) : expr(expr) {}
+
+    double
+    operator()(int i, int j) const {
+        return Operation::apply(expr(i, j));
+    }
+}; // UnaryExpression
+
+#define FIELD_EXPRESSION_BINARY_OPERATOR(OP, OPERATION) \
+template <class L, class R> \
+inline BinaryExpression<L, R, OPERATION> \
+operator OP(const FieldExpression<L> &left, const FieldExpression<R> &right) { \
+    return BinaryExpression<L, R, OPERATION>(left.self(), right.self()); \
+} \
+template <class R> \
+inline BinaryExpression<ScalarTerminal, R, OPERATION> \
+operator OP(double left, const FieldExpression<R> &right) { \
+    return BinaryExpression<ScalarTerminal, R, OPERATION>(ScalarTerminal(left), right.self()); \
+} \
+template <class L> \
+inline BinaryExpression<L, ScalarTerminal, OPERATION> \
+operator OP(const FieldExpression<L> &left, double right) { \
+    return BinaryExpression<L, ScalarTerminal, OPERATION>(left.self(), ScalarTerminal(right)); \
+}
+
+FIELD_EXPRESSION_BINARY_OPERATOR(+, PlusOperation)
+FIELD_EXPRESSION_BINARY_OPERATOR(-, MinusOperation)
+FIELD_EXPRESSION_BINARY_OPERATOR(*, MultiplyOperation)
+FIELD_EXPRESSION_BINARY_OPERATOR(/, DivideOperation)
+
+#undef FIELD_EXPRESSION_BINARY_OPERATOR
+
+template <class E>
+inline UnaryExpression<E, NegateOperation>
+operator-(const FieldExpression<E> &expr) {
+    return UnaryExpression<E, NegateOperation>(expr.self());
+}
+
+template <class E>
+inline UnaryExpression<E, SqrtOperation>
+sqrt(const FieldExpression<E> &expr) {
+    return UnaryExpression<E, SqrtOperation>(expr.self());
+}
+
+// -----------------------------------------------------------------------------
+// Assignments.
+
+template <class Target, class E>
+class Assignment {
+    Target target;
+    E expr;
+public:
+    Assignment(const Target &target, const E &expr)
+    : target(target), expr(expr) {}
+
+    void
+    operator()(int i, int j) const {
+        target.at(i, j) = expr(i, j);
+    }
+
+    const Mesh&
+    mesh() const {
+        return target.mesh();
+    }
+
+    void
+    applyBndCond(int j) const {
+        target.applyBndCond(j);
+    }
+}; // Assignment
+
+template <class Target, class E>
+inline Assignment<Target, E>
+assign(const Target &target, const FieldExpression<E> &expr) {
+    return Assignment<Target, E>(target, expr.self());
+}
+
+template <class Target>
+inline Assignment<Target, ScalarTerminal>
+assign(const Target &target, double value) {
+    return Assignment<Target, ScalarTerminal>(target, ScalarTerminal(value));
+}
+
+inline void
+evaluateCell(int, int) {}
+
+template <class A, class... As>
+inline void
+evaluateCell(int i, int j, const A &assignment, const As&... assignments) {
+    assignment(i, j);
+    evaluateCell(i, j, assignments...);
+}
+
+inline void
+applyBndConds(int) {}
+
+template <class A, class... As>
+inline void
+applyBndConds(int j, const A &assignment, const As&... assignments) {
+    assignment.applyBndCond(j);
+    applyBndConds(j, assignments...);
+}
+
+/**
+ *  Run the given assignments in one loop over the cells, and write the halo
+ *  columns of the assigned fields row by row.
+ */
+template <class A, class... As>
+void
+evaluate(const A &assignment, const As&... assignments) {
+    const Mesh &mesh = assignment.mesh();
+    int is = mesh.is(FULL), ie = mesh.ie(FULL);
+    #pragma omp parallel for
+    for (int j = mesh.js(FULL); j <= mesh.je(FULL); ++j) {
+        for (int i = is; i <= ie; ++i) {
+            evaluateCell(i, j, assignment, assignments...);
+        }
+        applyBndConds(j, assignment, assignments...);
+    }
+} // evaluate
+
+/**
+ *  Run the given assignments on the cells from (i0, j0) to (i1, j1) in the
+ *  calling thread, e.g. on one band of rows in a task (see TaskGraph), and
+ *  write the halo columns of the rows.
+ */
+template <class A, class... As>
+void
+evaluateRows(int i0, int i1, int j0, int j1, const A &assignment,
+             const As&... assignments) {
+    for (int j = j0; j <= j1; ++j) {
+        for (int i = i0; i <= i1; ++i) {
+            evaluateCell(i, j, assignment, assignments...);
+        }
+        applyBndConds(j, assignment, assignments...);
+    }
+} // evaluateRows
+
+/**
+ *  Run the given assignments on the cells from (i0, j0) to (i1, j1), e.g. in
+ *  a region of a nested refinement, with the rows shared by the threads.
+ */
+template <class A, class... As>
+void
+evaluateRegion(int i0, int i1, int j0, int j1, const A &assignment,
+               const As&... assignments) {
+    #pragma omp parallel for
+    for (int j = j0; j <= j1; ++j) {
+        evaluateRows(i0, i1, j, j, assignment, assignments...);
+    }
+} // evaluateRegion
+
+template <class FieldType>
+template <class E>
+inline TimeLevelTerminal<FieldType>& TimeLevelTerminal<FieldType>::
+operator=(const FieldExpression<E> &expr) {
+    evaluate(assign(*this, expr));
+    return *this;
+}
+
+template <class FieldType>
+inline TimeLevelTerminal<FieldType>& TimeLevelTerminal<FieldType>::
+operator=(const TimeLevelTerminal &other) {
+    evaluate(assign(*this, other));
+    return *this;
+}
+
+template <class FieldType>
+inline TimeLevelTerminal<FieldType>& TimeLevelTerminal<FieldType>::
+operator=(double value) {
+    evaluate(assign(*this, value));
+    return *this;
+}
+
+template <class FieldType>
+template <class E>
+inline SingleLevelTerminal<FieldType>& SingleLevelTerminal<FieldType>::
+operator=(const FieldExpression<E> &expr) {
+    evaluate(assign(*this, expr));
+    return *this;
+}
+
+template <class FieldType>
+inline SingleLevelTerminal<FieldType>& SingleLevelTerminal<FieldType>::
+operator=(const SingleLevelTerminal &other) {
+    evaluate(assign(*this, other));
+    return *this;
+}
+
+template <class FieldType>
+inline SingleLevelTerminal<FieldType>& SingleLevelTerminal<FieldType>::
+operator=(double value) {
+    evaluate(assign(*this, value));
+    return *this;
+}
+
+template <class FieldType>
+template <class E>
+inline ArenaTerminal<FieldType>& ArenaTerminal<FieldType>::
+operator=(const FieldExpression<E> &expr) {
+    evaluate(assign(*this, expr));
+    return *this;
+}
+
+template <class FieldType>
+inline ArenaTerminal<FieldType>& ArenaTerminal<FieldType>::
+operator=(const ArenaTerminal &other) {
+    evaluate(assign(*this, other));
+    return *this;
+}
+
+template <class FieldType>
+inline ArenaTerminal<FieldType>& ArenaTerminal<FieldType>::
+operator=(double value) {
+    evaluate(assign(*this, value));
+    return *this;
+}
+
+} // barotropic_model
+
+#endif // __FieldExpression__
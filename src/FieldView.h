@@ -0,0 +1,91 @@
+#ifndef __FieldView__
+#define __FieldView__
+
+#include "barotropic_model_commons.h"
+
+namespace barotropic_model {
+
+/**
+ *  These classes are zero-copy views of the model fields for the host code of
+ *  a coupled application, which steps the model in process instead of
+ *  exchanging data through the output files. The indices are zero-based over
+ *  the cells without halo, i.e. 0 <= i < numLon() and 0 <= j < numLat(), with
+ *  j = 0 on the South Pole.
+ *
+ *  ConstFieldView reads one time level of a prognostic variable. It is bound
+ *  to the current time level when it is taken, so it should be taken again
+ *  after each step. FieldView reads and writes a single-level field, e.g. the
+ *  surface geopotential or a forcing tendency, and it is valid as long as the
+ *  model lives.
+ */
+class ConstFieldView {
+    const Field<double, 2> *field;
+    TimeLevelIndex<2> timeIdx;
+    int is, js;
+    int _numLon, _numLat;
+public:
+    ConstFieldView(const Field<double, 2> &field,
+                   const TimeLevelIndex<2> &timeIdx) {
+        const Mesh &mesh = static_cast<const Mesh&>(field.mesh());
+        this->field = &field;
+        this->timeIdx = timeIdx;
+        is = mesh.is(field.gridType(0));
+        js = mesh.js(field.gridType(1));
+        _numLon = mesh.numGrid(0, field.gridType(0));
+        _numLat = mesh.numGrid(1, field.gridType(1));
+    }
+
+    double
+    operator()(int i, int j) const {
+        return (*field)(timeIdx, is+i, js+j);
+    }
+
+    int
+    numLon() const {
+        return _numLon;
+    }
+
+    int
+    numLat() const {
+        return _numLat;
+    }
+}; // ConstFieldView
+
+class FieldView {
+    Field<double> *field;
+    int is, js;
+    int _numLon, _numLat;
+public:
+    FieldView(Field<double> &field) {
+        const Mesh &mesh = static_cast<const Mesh&>(field.mesh());
+        this->field = &field;
+        is = mesh.is(field.gridType(0));
+        js = mesh.js(field.gridType(1));
+        _numLon = mesh.numGrid(0, field.gridType(0));
+        _numLat = mesh.numGrid(1, field.gridType(1));
+    }
+
+    double&
+    operator()(int i, int j) {
+        return (*field)(is+i, js+j);
+    }
+
+    double
+    operator()(int i, int j) const {
+        return (*field)(is+i, js+j);
+    }
+
+    int
+    numLon() const {
+        return _numLon;
+    }
+
+    int
+    numLat() const {
+        return _numLat;
+    }
+}; // FieldView
+
+} // barotropic_model
+
+#endif // __FieldView__
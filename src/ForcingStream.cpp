@@ -0,0 +1,253 @@
+#include "ForcingStream.h"
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+namespace barotropic_model {
+
+ForcingStream::ForcingStream() {
+    model = NULL;
+    numLon = numLat = 0;
+    numPrefetch = 2;
+    currentRecord = 0;
+    appliedRecord = -1;
+    appliedWeight = 0;
+    nextLoad = 0;
+    isStopped = false;
+    numStall = 0;
+    stallSeconds = 0;
+    REPORT_ONLINE;
+}
+
+ForcingStream::~ForcingStream() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        isStopped = true;
+    }
+    loadCondition.notify_all();
+    if (loader.joinable()) {
+        loader.join();
+    }
+    REPORT_OFFLINE;
+}
+
+void ForcingStream::
+setNumPrefetch(int numPrefetch) {
+    if (numPrefetch < 0) {
+        REPORT_ERROR("Prefetch number must not be negative!");
+    }
+    this->numPrefetch = numPrefetch;
+} // setNumPrefetch
+
+void ForcingStream::
+init(BarotropicModel &model, const string &indexFileName) {
+    this->model = &model;
+    numLon = model.mesh().numGrid(0, FULL);
+    numLat = model.mesh().numGrid(1, FULL);
+    readIndex(indexFileName);
+    for (int k = 0; k < variables.size(); ++k) {
+        buffers[variables[k]].resize(numLon*numLat);
+    }
+    loader = std::thread(&ForcingStream::load, this);
+} // init
+
+void ForcingStream::
+update(double seconds) {
+    // Find the last record not after the time.
+    int k = currentRecord;
+    while (k+1 < records.size() && records[k+1].seconds <= seconds) {
+        ++k;
+    }
+    bool isInterpolated = k+1 < records.size() && seconds > records[k].seconds;
+    double weight = 0;
+    if (isInterpolated) {
+        weight = (seconds-records[k].seconds)/
+                 (records[k+1].seconds-records[k].seconds);
+    }
+    // Nothing changes before the first or after the last record, so the
+    // model is left alone (e.g. its cached terms of the surface geopotential).
+    if (k == appliedRecord && weight == appliedWeight) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        currentRecord = k;
+        loaded.erase(loaded.begin(), loaded.lower_bound(k));
+        nextLoad = std::max(nextLoad, k);
+    }
+    loadCondition.notify_one();
+    bool isStalled = false;
+    std::shared_ptr<Data> data0 = waitRecord(k, isStalled), data1;
+    if (isInterpolated) {
+        data1 = waitRecord(k+1, isStalled);
+    }
+    if (isStalled) {
+        ++numStall;
+    }
+    // Interpolate in time.
+    for (int l = 0; l < variables.size(); ++l) {
+        vector<double> &buffer = buffers[variables[l]];
+        const vector<double> &values0 = data0->values[variables[l]];
+        if (data1 == NULL) {
+            buffer = values0;
+            continue;
+        }
+        const vector<double> &values1 = data1->values[variables[l]];
+        #pragma omp parallel for
+        for (int i = 0; i < buffer.size(); ++i) {
+            buffer[i] = (1-weight)*values0[i]+weight*values1[i];
+        }
+    }
+    // Apply to the model.
+    if (!buffers[SURFACE_GEOPOTENTIAL].empty()) {
+        FieldView ghs = model->surfaceGeopotentialView();
+        const vector<double> &buffer = buffers[SURFACE_GEOPOTENTIAL];
+        #pragma omp parallel for
+        for (int j = 0; j < numLat; ++j) {
+            for (int i = 0; i < numLon; ++i) {
+                ghs(i, j) = buffer[j*numLon+i];
+            }
+        }
+    }
+    const double *forcings[3];
+    bool hasForcing = false;
+    for (int l = 0; l < 3; ++l) {
+        const vector<double> &buffer = buffers[ZONAL_WIND_FORCING+l];
+        forcings[l] = buffer.empty() ? NULL : buffer.data();
+        hasForcing = hasForcing || !buffer.empty();
+    }
+    if (hasForcing) {
+        model->setForcing(forcings[0], forcings[1], forcings[2]);
+    }
+    appliedRecord = k;
+    appliedWeight = weight;
+} // update
+
+void ForcingStream::
+readIndex(const string &fileName) {
+    std::ifstream file(fileName.c_str());
+    if (!file) {
+        REPORT_ERROR("Failed to open forcing index \"" << fileName << "\"!");
+    }
+    // The record files are relative to the index.
+    string directory;
+    string::size_type pos = fileName.rfind('/');
+    if (pos != string::npos) {
+        directory = fileName.substr(0, pos+1);
+    }
+    string line;
+    int lineNo = 0;
+    while (std::getline(file, line)) {
+        ++lineNo;
+        line = line.substr(0, line.find('#'));
+        std::istringstream ss(line);
+        string kind;
+        if (!(ss >> kind)) continue;
+        if (kind == "variables") {
+            string name;
+            while (ss >> name) {
+                if (name == "ghs") {
+                    variables.push_back(SURFACE_GEOPOTENTIAL);
+                } else if (name == "fu") {
+                    variables.push_back(ZONAL_WIND_FORCING);
+                } else if (name == "fv") {
+                    variables.push_back(MERIDIONAL_WIND_FORCING);
+                } else if (name == "fgd") {
+                    variables.push_back(GEOPOTENTIAL_DEPTH_FORCING);
+                } else {
+                    REPORT_ERROR("Unknown forcing variable \"" << name <<
+                                 "\" on line " << lineNo << " of \"" <<
+                                 fileName << "\"!");
+                }
+            }
+        } else if (kind == "record") {
+            Record record;
+            if (!(ss >> record.seconds >> record.fileName)) {
+                REPORT_ERROR("Line " << lineNo << " of \"" << fileName << "\" " <<
+                             "should be \"record <seconds> <file>\"!");
+            }
+            if (!records.empty() && record.seconds <= records.back().seconds) {
+                REPORT_ERROR("Record times in \"" << fileName << "\" should " <<
+                             "be increasing!");
+            }
+            if (record.fileName[0] != '/') {
+                record.fileName = directory+record.fileName;
+            }
+            records.push_back(record);
+        } else {
+            REPORT_ERROR("Unknown line kind \"" << kind << "\" on line " <<
+                         lineNo << " of \"" << fileName << "\"!");
+        }
+    }
+    if (variables.empty() || records.empty()) {
+        REPORT_ERROR("No variable or record in \"" << fileName << "\"!");
+    }
+} // readIndex
+
+/**
+ *  Read the records in order in the background, up to numPrefetch records
+ *  after the two around the current time.
+ */
+void ForcingStream::
+load() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        loadCondition.wait(lock, [this] () {
+            return isStopped || (nextLoad < records.size() &&
+                                 nextLoad <= currentRecord+1+numPrefetch);
+        });
+        if (isStopped) return;
+        int recordIdx = nextLoad++;
+        lock.unlock();
+        std::shared_ptr<Data> data = readRecord(recordIdx);
+        lock.lock();
+        if (recordIdx >= currentRecord) {
+            loaded[recordIdx] = data;
+        }
+        readyCondition.notify_all();
+    }
+} // load
+
+std::shared_ptr<ForcingStream::Data> ForcingStream::
+readRecord(int recordIdx) const {
+    std::shared_ptr<Data> data(new Data);
+    const string &fileName = records[recordIdx].fileName;
+    std::ifstream file(fileName.c_str(), std::ios::binary);
+    if (!file) {
+        data->error = "Failed to open forcing record \""+fileName+"\"!";
+        return data;
+    }
+    for (int k = 0; k < variables.size(); ++k) {
+        vector<double> &values = data->values[variables[k]];
+        values.resize(numLon*numLat);
+        file.read(reinterpret_cast<char*>(values.data()),
+                  values.size()*sizeof(double));
+    }
+    if (!file || file.peek() != std::ifstream::traits_type::eof()) {
+        data->error = "Forcing record \""+fileName+"\" does not match "+
+                      "the variables and the mesh!";
+    }
+    return data;
+} // readRecord
+
+std::shared_ptr<ForcingStream::Data> ForcingStream::
+waitRecord(int recordIdx, bool &isStalled) {
+    typedef std::chrono::steady_clock Clock;
+    std::unique_lock<std::mutex> lock(mutex);
+    if (loaded.count(recordIdx) == 0) {
+        Clock::time_point t0 = Clock::now();
+        readyCondition.wait(lock, [this, recordIdx] () {
+            return loaded.count(recordIdx) > 0;
+        });
+        stallSeconds += std::chrono::duration<double>(Clock::now()-t0).count();
+        isStalled = true;
+    }
+    std::shared_ptr<Data> data = loaded[recordIdx];
+    lock.unlock();
+    if (!data->error.empty()) {
+        REPORT_ERROR(data->error);
+    }
+    return data;
+} // waitRecord
+
+} // barotropic_model
@@ -0,0 +1,129 @@
+#ifndef __ForcingStream__
+#define __ForcingStream__
+
+#include "BarotropicModel.h"
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace barotropic_model {
+
+/**
+ *  This class drives the model by a sequence of forcing records, e.g. a
+ *  time-varying topography or forcing tendencies, without stopping the run.
+ *  The records are valid at given times, and the model gets the linear
+ *  interpolation in time between the two records around its current time
+ *  (the first or last record outside them).
+ *
+ *  The sequence is listed in a text index file (text after "#" is ignored):
+ *
+ *      variables <name> ...
+ *      record    <seconds> <file>
+ *      ...
+ *
+ *  where the variables are some of "ghs" (surface geopotential), "fu", "fv"
+ *  and "fgd" (forcing tendencies of u, v and gd, see
+ *  BarotropicModel::forcing()), the seconds are the valid time from the
+ *  start of the run (increasing), and the file is relative to the index. A
+ *  record file holds the variables in the listed order, each as numLon x
+ *  numLat doubles in the native byte order, ordered by rows from the South
+ *  Pole as the views (see FieldView).
+ *
+ *  A background thread reads the next records while the model integrates,
+ *  so that the step loop does not wait for the files unless the reading is
+ *  slower than the steps. The waiting time is counted as stalls.
+ */
+class ForcingStream {
+public:
+    enum Variable {
+        SURFACE_GEOPOTENTIAL = 0, ZONAL_WIND_FORCING, MERIDIONAL_WIND_FORCING,
+        GEOPOTENTIAL_DEPTH_FORCING, NUM_VARIABLE
+    };
+protected:
+    struct Record {
+        double seconds;
+        string fileName;
+    };
+
+    struct Data {
+        vector<double> values[NUM_VARIABLE];
+        string error;       //>! why the record can not be read (if any)
+    };
+
+    BarotropicModel *model;
+    vector<Record> records;
+    vector<Variable> variables;     //>! in the order they are stored
+    int numLon, numLat;
+    int numPrefetch;        //>! records read ahead of the current ones
+    int currentRecord;      //>! last record not after the model time
+    int appliedRecord;      //>! record of the last applied forcing (-1 for none)
+    double appliedWeight;   //>! weight of the next record in it
+    vector<double> buffers[NUM_VARIABLE];   //>! interpolated in time
+    // Records read by the background thread.
+    std::map<int, std::shared_ptr<Data> > loaded;
+    int nextLoad;
+    bool isStopped;
+    std::mutex mutex;
+    std::condition_variable loadCondition;  //>! for a new window or stop
+    std::condition_variable readyCondition; //>! for a new loaded record
+    std::thread loader;
+    int numStall;
+    double stallSeconds;
+public:
+    ForcingStream();
+    virtual ~ForcingStream();
+
+    /**
+     *  Set the number of records read ahead (2 by default). This must be
+     *  called before init().
+     */
+    void
+    setNumPrefetch(int numPrefetch);
+
+    /**
+     *  Read the index for the initialized model, and start reading the
+     *  records in the background.
+     */
+    void
+    init(BarotropicModel &model, const string &indexFileName);
+
+    /**
+     *  Apply the forcing at the given seconds from the start to the model,
+     *  which then takes effect in the next step. The model is not touched
+     *  when the forcing is the same as the last applied one.
+     */
+    void
+    update(double seconds);
+
+    /**
+     *  Return the number of updates that waited for the records, and the
+     *  total waiting time in seconds.
+     */
+    int
+    numStallStep() const {
+        return numStall;
+    }
+
+    double
+    stallTime() const {
+        return stallSeconds;
+    }
+private:
+    void
+    readIndex(const string &fileName);
+
+    void
+    load();
+
+    std::shared_ptr<Data>
+    readRecord(int recordIdx) const;
+
+    std::shared_ptr<Data>
+    waitRecord(int recordIdx, bool &isStalled);
+}; // ForcingStream
+
+} // barotropic_model
+
+#endif // __ForcingStream__
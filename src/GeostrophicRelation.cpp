@@ -1,4 +1,5 @@
 #include "GeostrophicRelation.h"
+#include "BoundaryExchange.h"
 
 namespace barotropic_model {
 
@@ -44,8 +45,7 @@ run(const Field<double> &ghs, const TimeLevelIndex<2> &timeIdx,
         REPORT_ERROR("Under construction!");
     }
     // -------------------------------------------------------------------------
-    u.applyBndCond(timeIdx);
-    v.applyBndCond(timeIdx);
+    BoundaryExchange::run(timeIdx, {&u, &v});
 }
 
 }
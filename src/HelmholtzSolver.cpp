@@ -0,0 +1,126 @@
+#include "HelmholtzSolver.h"
+
+namespace barotropic_model {
+
+HelmholtzSolver::HelmholtzSolver() {
+    _mesh = NULL;
+    factorizedC2 = -1;
+    REPORT_ONLINE;
+}
+
+HelmholtzSolver::~HelmholtzSolver() {
+    REPORT_OFFLINE;
+}
+
+void HelmholtzSolver::
+init(const Mesh &mesh, const double *cosLat) {
+    _mesh = &mesh;
+    numLon = mesh.numGrid(0, FULL);
+    numLat = mesh.numGrid(1, FULL);
+    numMode = numLon/2+1;
+    fft.init(numLon);
+    const Domain &domain = static_cast<const Domain&>(mesh.domain());
+    double a = domain.radius();
+    double dlon = mesh.gridInterval(0, FULL, 0);
+    double dlat = mesh.gridInterval(1, FULL, 0);
+    int js = mesh.js(FULL), jn = mesh.je(FULL);
+    // Note: The meridional fluxes live on the rows between the Poles, so the
+    //       coupling through a Pole row is absent.
+    lower.assign(numLat, 0.0);
+    upper.assign(numLat, 0.0);
+    zonal.assign(numLat, 0.0);
+    for (int j = js; j <= jn; ++j) {
+        double factor = 1/(4*a*a*dlat*dlat*cosLat[j]);
+        if (j-1 > js) lower[j-js] = cosLat[j-1]*factor;
+        if (j+1 < jn) upper[j-js] = cosLat[j+1]*factor;
+        if (j != js && j != jn) {
+            zonal[j-js] = 1/pow(a*cosLat[j]*dlon, 2);
+        }
+    }
+    sin2.resize(numMode);
+    for (int m = 0; m < numMode; ++m) {
+        sin2[m] = pow(sin(m*dlon), 2);
+    }
+    modLower.resize(numMode*numLat);
+    modUpper.resize(numMode*numLat);
+    invDenom.resize(numMode*numLat);
+    work.resize(numLat*numLon);
+    spec.resize(numLat*numLon);
+    factorizedC2 = -1;
+} // init
+
+void HelmholtzSolver::
+factorize(double c2) {
+    #pragma omp parallel for
+    for (int m = 0; m < numMode; ++m) {
+        double *lo = &modLower[m*numLat];
+        double *up = &modUpper[m*numLat];
+        double *inv = &invDenom[m*numLat];
+        for (int j = 0; j < numLat; ++j) {
+            bool isPole = j == 0 || j == numLat-1;
+            if (m != 0 && isPole) {
+                // The Poles have no wave, so the row is the identity.
+                lo[j] = 0; up[j] = 0; inv[j] = 1;
+                continue;
+            }
+            double diag = 1+c2*(lower[j]+upper[j]+zonal[j]*sin2[m]);
+            lo[j] = -c2*lower[j];
+            double denom = j >= 2 ? diag-lo[j]*up[j-2] : diag;
+            inv[j] = 1/denom;
+            up[j] = -c2*upper[j]*inv[j];
+        }
+    }
+    factorizedC2 = c2;
+} // factorize
+
+void HelmholtzSolver::
+solve(double c2, const ArenaField &r, ArenaField &x) {
+    if (c2 != factorizedC2) {
+        factorize(c2);
+    }
+    const Mesh &mesh = *_mesh;
+    int is = mesh.is(FULL), ie = mesh.ie(FULL), js = mesh.js(FULL);
+    // Transform the rows.
+    #pragma omp parallel for
+    for (int j = 0; j < numLat; ++j) {
+        Complex *row = &work[j*numLon];
+        for (int i = is; i <= ie; ++i) {
+            row[i-is] = Complex(r(i, j+js), 0.0);
+        }
+        fft.forward(row, &spec[j*numLon]);
+    }
+    // Solve the two chains of each wavenumber.
+    // Note: Wavenumbers m and N-m share the factors.
+    #pragma omp parallel for
+    for (int k = 0; k < numLon; ++k) {
+        int m = std::min(k, numLon-k);
+        const double *lo = &modLower[m*numLat];
+        const double *up = &modUpper[m*numLat];
+        const double *inv = &invDenom[m*numLat];
+        if (m != 0) {
+            spec[k] = 0.0;
+            spec[(numLat-1)*numLon+k] = 0.0;
+        }
+        for (int j = 0; j < numLat; ++j) {
+            Complex &y = spec[j*numLon+k];
+            if (j >= 2) y -= lo[j]*spec[(j-2)*numLon+k];
+            y *= inv[j];
+        }
+        for (int j = numLat-3; j >= 0; --j) {
+            spec[j*numLon+k] -= up[j]*spec[(j+2)*numLon+k];
+        }
+    }
+    // Transform back.
+    #pragma omp parallel for
+    for (int j = 0; j < numLat; ++j) {
+        Complex *row = &work[j*numLon];
+        fft.backward(&spec[j*numLon], row);
+        for (int i = is; i <= ie; ++i) {
+            x(i, j+js) = row[i-is].real();
+        }
+        x(is-1, j+js) = x(ie, j+js);
+        x(ie+1, j+js) = x(is, j+js);
+    }
+} // solve
+
+} // barotropic_model
@@ -0,0 +1,64 @@
+#ifndef __HelmholtzSolver__
+#define __HelmholtzSolver__
+
+#include "ArenaField.h"
+#include "ZonalFFT.h"
+
+namespace barotropic_model {
+
+/**
+ *  This class solves the Helmholtz problem
+ *
+ *      x - c² ∇·∇x = r
+ *
+ *  on the cell centers of the A-grid mesh, where ∇ and ∇· are the centered
+ *  differences of the A-grid models (spanning two grid intervals, with the
+ *  Pole rows as zonal means fed by the fluxes on their neighbor rows), so
+ *  the solution is exact for the discrete semi-implicit system.
+ *
+ *  The operator is diagonal in the zonal wavenumber m, so each row is
+ *  transformed by FFT, and each wavenumber is solved by the Thomas algorithm
+ *  in latitude. Since the centered differences couple row j with rows j±2,
+ *  the system of one wavenumber is two independent tridiagonal chains (even
+ *  and odd rows). The Poles only take part in m = 0. The factorization is
+ *  kept until c² changes.
+ */
+class HelmholtzSolver {
+    typedef ZonalFFT::Complex Complex;
+
+    const Mesh *_mesh;
+    ZonalFFT fft;
+    int numLon, numLat;
+    int numMode;            //>! number of distinct wavenumbers (N/2+1)
+    vector<double> lower;   //>! ∇·∇ coefficients of row j-2 (without c²)
+    vector<double> upper;   //>! ∇·∇ coefficients of row j+2 (without c²)
+    vector<double> zonal;   //>! 1/(a cos(lat) dlon)² (zero on the Poles)
+    vector<double> sin2;    //>! sin²(m dlon) for each wavenumber
+    double factorizedC2;
+    vector<double> modLower, modUpper, invDenom; //>! Thomas factors (mode, row)
+    vector<Complex> work, spec;
+public:
+    HelmholtzSolver();
+    ~HelmholtzSolver();
+
+    /**
+     *  Set up the solver for the given mesh and the cos(lat) coefficients of
+     *  the model (including the special values on the Poles).
+     */
+    void
+    init(const Mesh &mesh, const double *cosLat);
+
+    /**
+     *  Solve the problem for the right hand side r into x (with the zonal
+     *  halo). They can be the same field.
+     */
+    void
+    solve(double c2, const ArenaField &r, ArenaField &x);
+private:
+    void
+    factorize(double c2);
+}; // HelmholtzSolver
+
+} // barotropic_model
+
+#endif // __HelmholtzSolver__
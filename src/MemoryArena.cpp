@@ -0,0 +1,70 @@
+#include "MemoryArena.h"
+#include <sys/mman.h>
+
+namespace barotropic_model {
+
+MemoryArena::MemoryArena() {
+    base = NULL;
+    capacity = 0;
+    offset = 0;
+    _hugePageMode = NO_HUGE_PAGE;
+}
+
+MemoryArena::~MemoryArena() {
+    if (base != NULL) {
+        munmap(base, capacity);
+    }
+}
+
+void MemoryArena::
+init(size_t size, HugePageMode hugePageMode) {
+    if (base != NULL) {
+        REPORT_ERROR("Memory arena has already been initialized!");
+    }
+    _hugePageMode = hugePageMode;
+    void *region = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    if (hugePageMode == EXPLICIT_HUGE_PAGE) {
+        capacity = alignedSize(size, HUGE_PAGE_SIZE);
+        region = mmap(NULL, capacity, PROT_READ|PROT_WRITE,
+                      MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+        if (region == MAP_FAILED) {
+            REPORT_WARNING("Failed to map explicit huge pages, use transparent "
+                           "huge pages instead.");
+            _hugePageMode = TRANSPARENT_HUGE_PAGE;
+        }
+    }
+#else
+    if (hugePageMode == EXPLICIT_HUGE_PAGE) {
+        _hugePageMode = TRANSPARENT_HUGE_PAGE;
+    }
+#endif
+    if (region == MAP_FAILED) {
+        capacity = alignedSize(size, _hugePageMode == NO_HUGE_PAGE ?
+                                     PAGE_SIZE : HUGE_PAGE_SIZE);
+        region = mmap(NULL, capacity, PROT_READ|PROT_WRITE,
+                      MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+        if (region == MAP_FAILED) {
+            REPORT_ERROR("Failed to map " << capacity << " bytes for memory arena!");
+        }
+#ifdef MADV_HUGEPAGE
+        if (_hugePageMode == TRANSPARENT_HUGE_PAGE) {
+            madvise(region, capacity, MADV_HUGEPAGE);
+        }
+#endif
+    }
+    base = static_cast<char*>(region);
+    offset = 0;
+} // init
+
+void* MemoryArena::
+allocate(size_t size, size_t alignment) {
+    size_t start = alignedSize(offset, alignment);
+    if (base == NULL || start+size > capacity) {
+        REPORT_ERROR("Memory arena is exhausted!");
+    }
+    offset = start+size;
+    return base+start;
+} // allocate
+
+} // barotropic_model
@@ -0,0 +1,76 @@
+#ifndef __MemoryArena__
+#define __MemoryArena__
+
+#include "barotropic_model_commons.h"
+
+namespace barotropic_model {
+
+/**
+ *  This class reserves one aligned memory region and hands out blocks from it
+ *  by bumping a pointer, so that the arrays owned by a model are packed into
+ *  contiguous pages instead of scattered heap allocations. The region is
+ *  mapped but not touched, so the pages are placed on the NUMA node of the
+ *  thread that first writes them (see ArenaField).
+ *
+ *  The region can be backed by transparent huge pages (madvise) or explicit
+ *  huge pages (MAP_HUGETLB) to reduce TLB pressure on big meshes. When
+ *  explicit huge pages are not available, it falls back to transparent ones.
+ */
+class MemoryArena {
+public:
+    enum HugePageMode {
+        NO_HUGE_PAGE, TRANSPARENT_HUGE_PAGE, EXPLICIT_HUGE_PAGE
+    };
+
+    static const size_t CACHE_LINE_SIZE = 64;
+    static const size_t PAGE_SIZE = 4096;
+    static const size_t HUGE_PAGE_SIZE = 2*1024*1024;
+private:
+    char *base;
+    size_t capacity;
+    size_t offset;
+    HugePageMode _hugePageMode;
+public:
+    MemoryArena();
+    ~MemoryArena();
+
+    void
+    init(size_t size, HugePageMode hugePageMode = NO_HUGE_PAGE);
+
+    /**
+     *  Return a block of the given size, which is aligned to the given
+     *  alignment (a power of 2).
+     */
+    void*
+    allocate(size_t size, size_t alignment = CACHE_LINE_SIZE);
+
+    template <typename T>
+    T*
+    allocate(int n, size_t alignment = CACHE_LINE_SIZE) {
+        return static_cast<T*>(allocate(n*sizeof(T), alignment));
+    }
+
+    HugePageMode
+    hugePageMode() const {
+        return _hugePageMode;
+    }
+
+    size_t
+    size() const {
+        return capacity;
+    }
+
+    size_t
+    usedSize() const {
+        return offset;
+    }
+
+    static size_t
+    alignedSize(size_t size, size_t alignment = CACHE_LINE_SIZE) {
+        return (size+alignment-1)/alignment*alignment;
+    }
+}; // MemoryArena
+
+} // barotropic_model
+
+#endif // __MemoryArena__
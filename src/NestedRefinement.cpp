@@ -0,0 +1,309 @@
+#include "NestedRefinement.h"
+#include "BoundaryExchange.h"
+
+namespace barotropic_model {
+
+NestedRefinement::NestedRefinement() {
+    meshRatio = 3;
+    stepRatio = 3;
+    regionLon[0] = regionLon[1] = 0;
+    regionLat[0] = regionLat[1] = 0;
+    parent = NULL;
+    child = NULL;
+    dt = 0;
+    parentIs = parentIe = parentJs = parentJe = 0;
+    REPORT_ONLINE;
+}
+
+NestedRefinement::~NestedRefinement() {
+    if (child != NULL) {
+        delete child;
+    }
+    REPORT_OFFLINE;
+}
+
+void NestedRefinement::
+setRefinement(int meshRatio, int stepRatio) {
+    if (child != NULL) {
+        REPORT_ERROR("Refinement must be set before initialization!");
+    }
+    if (meshRatio < 1 || meshRatio%2 == 0 || stepRatio < 1) {
+        REPORT_ERROR("Mesh ratio must be odd and step ratio must be positive!");
+    }
+    this->meshRatio = meshRatio;
+    this->stepRatio = stepRatio;
+} // setRefinement
+
+void NestedRefinement::
+setRegion(double lon0, double lon1, double lat0, double lat1) {
+    if (child != NULL) {
+        REPORT_ERROR("Region must be set before initialization!");
+    }
+    if (lon0 < 0 || lon0 >= lon1 || lon1 > 360 || lat0 <= -90 ||
+        lat0 >= lat1 || lat1 >= 90) {
+        REPORT_ERROR("Invalid region (" << lon0 << ":" << lon1 << ", " <<
+                     lat0 << ":" << lat1 << ")!");
+    }
+    regionLon[0] = lon0; regionLon[1] = lon1;
+    regionLat[0] = lat0; regionLat[1] = lat1;
+} // setRegion
+
+void NestedRefinement::
+init(BarotropicModel_A_ImplicitMidpoint &parent, TimeManager &timeManager) {
+    if (child != NULL) {
+        REPORT_ERROR("Nested refinement is already initialized!");
+    }
+    if (parent.isRegional()) {
+        REPORT_ERROR("Parent of a nested refinement must not be regional!");
+    }
+    this->parent = &parent;
+    dt = timeManager.stepSizeInSeconds();
+    const Mesh &parentMesh = parent.mesh();
+    int numParentLon = parentMesh.numGrid(0, FULL);
+    int numParentLat = parentMesh.numGrid(1, FULL);
+    // Find the parent cells whose centers are in the region.
+    double dlon = parentMesh.gridInterval(0, FULL, 0);
+    double dlat = parentMesh.gridInterval(1, FULL, 0);
+    if (regionLon[0] < dlon/RAD || regionLon[1] > 360-dlon/RAD) {
+        REPORT_ERROR("Region (" << regionLon[0] << ":" << regionLon[1] <<
+                     ") must be at least one grid interval (" << dlon/RAD <<
+                     " degrees) away from the zero meridian!");
+    }
+    const double eps = 1.0e-10;
+    parentIs = static_cast<int>(ceil(regionLon[0]*RAD/dlon-eps));
+    parentIe = static_cast<int>(floor(regionLon[1]*RAD/dlon+eps));
+    parentJs = static_cast<int>(ceil((regionLat[0]*RAD+M_PI_2)/dlat-eps));
+    parentJe = static_cast<int>(floor((regionLat[1]*RAD+M_PI_2)/dlat+eps));
+    if (parentIe-parentIs < 2 || parentJe-parentJs < 2) {
+        REPORT_ERROR("Region covers less than 3x3 parent cells!");
+    }
+    // The ring of child cells around the patch must be on the mesh, and off
+    // the Poles.
+    int h = meshRatio/2;
+    int childIs = parentIs*meshRatio-h, childIe = parentIe*meshRatio+h;
+    int childJs = parentJs*meshRatio-h, childJe = parentJe*meshRatio+h;
+    int numChildLon = numParentLon*meshRatio;
+    int numChildLat = (numParentLat-1)*meshRatio+1;
+    if (childIs-1 < 0 || childIe+1 > numChildLon-1 ||
+        childJs-1 < 1 || childJe+1 > numChildLat-2) {
+        REPORT_ERROR("Ring around the nested patch of the region (" <<
+                     regionLon[0] << ":" << regionLon[1] << ", " <<
+                     regionLat[0] << ":" << regionLat[1] << ") is off the mesh " <<
+                     "or on the Poles!");
+    }
+    // Create the child, which shares the time manager, so that its output
+    // has the same time stamps.
+    child = new BarotropicModel_A_ImplicitMidpoint;
+    child->setLeanMemory(parent.isLeanMemory());
+    child->setVerbose(false);
+    child->init(timeManager, numChildLon, numChildLat);
+    const Mesh &childMesh = child->mesh();
+    int is = childMesh.is(FULL), js = childMesh.js(FULL);
+    child->setRegion(is+childIs, is+childIe, js+childJs, js+childJe);
+    // Interpolate the parent onto the whole child mesh.
+    const TimeLevelIndex<2> &parentTimeIdx = parent.currentTimeIdx();
+    #pragma omp parallel for
+    for (int j = 0; j < childMesh.numGrid(1, FULL); ++j) {
+        for (int i = 0; i < childMesh.numGrid(0, FULL); ++i) {
+            Stencil stencil = calcStencil(i, j);
+            child->zonalWind()(_childTimeIdx, is+i, js+j) =
+                interpolate(parent.zonalWind(), parentTimeIdx, stencil);
+            child->meridionalWind()(_childTimeIdx, is+i, js+j) =
+                interpolate(parent.meridionalWind(), parentTimeIdx, stencil);
+            child->geopotentialDepth()(_childTimeIdx, is+i, js+j) =
+                interpolate(parent.geopotentialDepth(), parentTimeIdx, stencil);
+            child->surfaceGeopotential()(is+i, js+j) =
+                interpolate(parent.surfaceGeopotential(), stencil);
+        }
+    }
+    BoundaryExchange::run(_childTimeIdx, {&child->zonalWind(),
+                                          &child->meridionalWind(),
+                                          &child->geopotentialDepth()});
+    BoundaryExchange::run({&child->surfaceGeopotential()});
+    // Collect the ring of child cells around the patch.
+    for (int j = childJs-1; j <= childJe+1; ++j) {
+        for (int i = childIs-1; i <= childIe+1; ++i) {
+            if (j != childJs-1 && j != childJe+1 &&
+                i != childIs-1 && i != childIe+1) continue;
+            boundaryI.push_back(i);
+            boundaryJ.push_back(j);
+            boundaryStencils.push_back(calcStencil(i, j));
+        }
+    }
+    double numPatchCell = (childIe-childIs+1)*(childJe-childJs+1);
+    REPORT_NOTICE("Nested refinement of " << childIe-childIs+1 << "x" <<
+                  childJe-childJs+1 << " cells (" << std::fixed <<
+                  setprecision(1) << numPatchCell*100/
+                  (childMesh.numGrid(0, FULL)*childMesh.numGrid(1, FULL)) <<
+                  "% of the refined mesh).");
+} // init
+
+void NestedRefinement::
+step() {
+    if (child == NULL) {
+        REPORT_ERROR("Nested refinement is not initialized!");
+    }
+    interpolateBoundary(startU, startV, startGd);
+    parent->step();
+    interpolateBoundary(endU, endV, endGd);
+    double childDt = dt/stepRatio;
+    for (int k = 1; k <= stepRatio; ++k) {
+        // Set the ring on both time levels of the sub-step.
+        setBoundary(_childTimeIdx, double(k-1)/stepRatio);
+        setBoundary(_childTimeIdx+1, double(k)/stepRatio);
+        child->integrate(_childTimeIdx, childDt);
+        _childTimeIdx.shift();
+    }
+    feedback();
+} // step
+
+/**
+ *  The child has its own boundary fluxes, so the mean geopotential depth of
+ *  the blocks is scaled to keep the mass of the parent over them, and the
+ *  total mass of the parent is still conserved.
+ */
+void NestedRefinement::
+feedback(bool withSurfaceGeopotential) {
+    const Mesh &parentMesh = parent->mesh(), &childMesh = child->mesh();
+    const TimeLevelIndex<2> &parentTimeIdx = parent->currentTimeIdx();
+    int pis = parentMesh.is(FULL), pjs = parentMesh.js(FULL);
+    int cis = childMesh.is(FULL), cjs = childMesh.js(FULL);
+    int h = meshRatio/2;
+    int numLon = parentIe-parentIs-1, numLat = parentJe-parentJs-1;
+    const Field<double, 2> &u = child->zonalWind();
+    const Field<double, 2> &v = child->meridionalWind();
+    const Field<double, 2> &gd = child->geopotentialDepth();
+    const Field<double> &ghs = child->surfaceGeopotential();
+    Field<double, 2> &parentGd = parent->geopotentialDepth();
+    vector<double> blockU(numLon*numLat), blockV(numLon*numLat);
+    vector<double> blockGd(numLon*numLat), blockGhs(numLon*numLat);
+    vector<double> parentMass(numLat), childMass(numLat);
+    // Average the blocks.
+    #pragma omp parallel for
+    for (int l = 0; l < numLat; ++l) {
+        int pj = parentJs+1+l;
+        double parentCosLat = parentMesh.cosLat(FULL, pjs+pj);
+        parentMass[l] = childMass[l] = 0;
+        for (int k = 0; k < numLon; ++k) {
+            int pi = parentIs+1+k;
+            double area = 0, mass = 0, momentumU = 0, momentumV = 0;
+            double volume = 0;
+            for (int j = cjs+pj*meshRatio-h; j <= cjs+pj*meshRatio+h; ++j) {
+                double cosLat = childMesh.cosLat(FULL, j);
+                for (int i = cis+pi*meshRatio-h; i <= cis+pi*meshRatio+h; ++i) {
+                    double cellMass = gd(_childTimeIdx, i, j)*cosLat;
+                    area += cosLat;
+                    mass += cellMass;
+                    momentumU += u(_childTimeIdx, i, j)*cellMass;
+                    momentumV += v(_childTimeIdx, i, j)*cellMass;
+                    volume += ghs(i, j)*cosLat;
+                }
+            }
+            int m = l*numLon+k;
+            blockU[m] = momentumU/mass;
+            blockV[m] = momentumV/mass;
+            blockGd[m] = mass/area;
+            blockGhs[m] = volume/area;
+            parentMass[l] += parentGd(parentTimeIdx, pis+pi, pjs+pj)*parentCosLat;
+            childMass[l] += blockGd[m]*parentCosLat;
+        }
+    }
+    double scale = 0, totalChildMass = 0;
+    for (int l = 0; l < numLat; ++l) {
+        scale += parentMass[l];
+        totalChildMass += childMass[l];
+    }
+    scale /= totalChildMass;
+    // Replace the parent cells.
+    // Note: The surface geopotential is changed through its view, so that
+    //       the parent rebuilds the terms derived from it.
+    FieldView parentGhs = withSurfaceGeopotential ?
+        parent->surfaceGeopotentialView() :
+        FieldView(parent->surfaceGeopotential());
+    #pragma omp parallel for
+    for (int l = 0; l < numLat; ++l) {
+        int pj = pjs+parentJs+1+l;
+        for (int k = 0; k < numLon; ++k) {
+            int pi = pis+parentIs+1+k, m = l*numLon+k;
+            parent->zonalWind()(parentTimeIdx, pi, pj) = blockU[m];
+            parent->meridionalWind()(parentTimeIdx, pi, pj) = blockV[m];
+            parentGd(parentTimeIdx, pi, pj) = blockGd[m]*scale;
+            if (withSurfaceGeopotential) {
+                parentGhs(pi-pis, pj-pjs) = blockGhs[m];
+            }
+        }
+    }
+    BoundaryExchange::run(parentTimeIdx, {&parent->zonalWind(),
+                                          &parent->meridionalWind(),
+                                          &parentGd});
+    if (withSurfaceGeopotential) {
+        BoundaryExchange::run({&parent->surfaceGeopotential()});
+    }
+} // feedback
+
+/**
+ *  The child cell (i, j) is at (i/meshRatio, j/meshRatio) on the parent mesh
+ *  (all zero-based).
+ */
+NestedRefinement::Stencil NestedRefinement::
+calcStencil(int i, int j) const {
+    const Mesh &parentMesh = parent->mesh();
+    int numParentLon = parentMesh.numGrid(0, FULL);
+    int numParentLat = parentMesh.numGrid(1, FULL);
+    Stencil stencil;
+    int i0 = i/meshRatio, j0 = j/meshRatio;
+    stencil.parentI[0] = parentMesh.is(FULL)+i0;
+    stencil.parentI[1] = parentMesh.is(FULL)+(i0+1)%numParentLon;
+    stencil.parentJ[0] = parentMesh.js(FULL)+j0;
+    stencil.parentJ[1] = parentMesh.js(FULL)+std::min(j0+1, numParentLat-1);
+    stencil.weightI = double(i%meshRatio)/meshRatio;
+    stencil.weightJ = double(j%meshRatio)/meshRatio;
+    return stencil;
+} // calcStencil
+
+double NestedRefinement::
+interpolate(const Field<double, 2> &field, const TimeLevelIndex<2> &timeIdx,
+            const Stencil &stencil) const {
+    const int *pi = stencil.parentI, *pj = stencil.parentJ;
+    double wi = stencil.weightI, wj = stencil.weightJ;
+    return (1-wj)*((1-wi)*field(timeIdx, pi[0], pj[0])+
+                   wi*field(timeIdx, pi[1], pj[0]))+
+           wj*((1-wi)*field(timeIdx, pi[0], pj[1])+
+               wi*field(timeIdx, pi[1], pj[1]));
+} // interpolate
+
+double NestedRefinement::
+interpolate(const Field<double> &field, const Stencil &stencil) const {
+    const int *pi = stencil.parentI, *pj = stencil.parentJ;
+    double wi = stencil.weightI, wj = stencil.weightJ;
+    return (1-wj)*((1-wi)*field(pi[0], pj[0])+wi*field(pi[1], pj[0]))+
+           wj*((1-wi)*field(pi[0], pj[1])+wi*field(pi[1], pj[1]));
+} // interpolate
+
+void NestedRefinement::
+interpolateBoundary(vector<double> &u, vector<double> &v,
+                    vector<double> &gd) const {
+    const TimeLevelIndex<2> &timeIdx = parent->currentTimeIdx();
+    u.resize(boundaryStencils.size());
+    v.resize(boundaryStencils.size());
+    gd.resize(boundaryStencils.size());
+    for (int k = 0; k < boundaryStencils.size(); ++k) {
+        u[k] = interpolate(parent->zonalWind(), timeIdx, boundaryStencils[k]);
+        v[k] = interpolate(parent->meridionalWind(), timeIdx, boundaryStencils[k]);
+        gd[k] = interpolate(parent->geopotentialDepth(), timeIdx, boundaryStencils[k]);
+    }
+} // interpolateBoundary
+
+void NestedRefinement::
+setBoundary(const TimeLevelIndex<2> &timeIdx, double weight) {
+    const Mesh &childMesh = child->mesh();
+    int is = childMesh.is(FULL), js = childMesh.js(FULL);
+    for (int k = 0; k < boundaryI.size(); ++k) {
+        int i = is+boundaryI[k], j = js+boundaryJ[k];
+        child->zonalWind()(timeIdx, i, j) = (1-weight)*startU[k]+weight*endU[k];
+        child->meridionalWind()(timeIdx, i, j) = (1-weight)*startV[k]+weight*endV[k];
+        child->geopotentialDepth()(timeIdx, i, j) = (1-weight)*startGd[k]+weight*endGd[k];
+    }
+} // setBoundary
+
+} // barotropic_model
@@ -0,0 +1,140 @@
+#ifndef __NestedRefinement__
+#define __NestedRefinement__
+
+#include "BarotropicModel_A_ImplicitMidpoint.h"
+
+namespace barotropic_model {
+
+/**
+ *  This class refines one region of a model (the parent) by a patch that is
+ *  integrated by its own model instance (the child) on a mesh meshRatio times
+ *  finer, with stepRatio sub-steps in each step of the parent, e.g. to
+ *  resolve the topography of ToyTestCase without refining the whole mesh.
+ *
+ *  The patch covers the parent cells whose centers are in the given region.
+ *  The child mesh is the parent one refined, so every meshRatio-th child cell
+ *  is on a parent cell, and each parent cell of the patch is the center of a
+ *  block of meshRatio x meshRatio child cells (meshRatio must be odd). Only
+ *  the blocks of the patch are updated by the child (see
+ *  BarotropicModel_A_ImplicitMidpoint::setRegion()), so its cost is about
+ *  the fraction of the globe covered by the patch of a globally refined run.
+ *
+ *  Note: The child fields still cover the whole refined mesh, since the
+ *        mesh is global, so the child takes meshRatio^2 times the memory of
+ *        the parent (9 times by default) however small the patch is.
+ *
+ *  In each step, the parent is stepped first. Then the ring of child cells
+ *  around the patch is interpolated bilinearly from the parent before and
+ *  after its step, and linearly in time for each sub-step of the child. At
+ *  last, the parent cells of the patch (except its outermost ones, which are
+ *  next to the boundary ring) are replaced by their blocks on the child,
+ *  where the geopotential depth is the area-weighted mean, and the winds are
+ *  the mass-weighted means. The mean geopotential depths are scaled to the
+ *  mass of the parent over them, so the parent conserves its total mass.
+ */
+class NestedRefinement {
+public:
+    /**
+     *  The parent cells around a child cell and the bilinear weights of the
+     *  second ones.
+     */
+    struct Stencil {
+        int parentI[2], parentJ[2];
+        double weightI, weightJ;
+    };
+protected:
+    int meshRatio;          //>! parent grid interval / child grid interval
+    int stepRatio;          //>! parent time step / child time step
+    double regionLon[2];    //>! region in degrees
+    double regionLat[2];
+    BarotropicModel_A_ImplicitMidpoint *parent;
+    BarotropicModel_A_ImplicitMidpoint *child;
+    TimeLevelIndex<2> _childTimeIdx;
+    double dt;              //>! time step of the parent
+    int parentIs, parentIe; //>! parent cells of the patch (zero-based)
+    int parentJs, parentJe;
+    vector<int> boundaryI, boundaryJ;   //>! ring of child cells (zero-based)
+    vector<Stencil> boundaryStencils;
+    vector<double> startU, startV, startGd; //>! ring before the parent step
+    vector<double> endU, endV, endGd;       //>! ring after the parent step
+public:
+    NestedRefinement();
+    virtual ~NestedRefinement();
+
+    /**
+     *  Set the mesh ratio (odd, 3 by default) and the time step ratio (3 by
+     *  default) of the child to the parent. This must be called before
+     *  init().
+     */
+    void
+    setRefinement(int meshRatio, int stepRatio);
+
+    /**
+     *  Set the region in degrees, which must not cross the zero meridian or
+     *  come close to the Poles. The region must be at least one parent grid
+     *  interval away from the zero meridian, so that the ring of child cells
+     *  around the patch is on the mesh, which is checked by init(). This must
+     *  be called before init().
+     */
+    void
+    setRegion(double lon0, double lon1, double lat0, double lat1);
+
+    /**
+     *  Create the child for the given parent, which has been initialized by
+     *  init() with the given time manager and has its initial condition, and
+     *  interpolate the state and surface geopotential of the parent onto the
+     *  child. The child can then be given its own initial condition at its
+     *  resolution (e.g. by a test case), followed by feedback(true).
+     */
+    void
+    init(BarotropicModel_A_ImplicitMidpoint &parent, TimeManager &timeManager);
+
+    /**
+     *  Advance the parent by one step and the child by the sub-steps, and
+     *  feed the child back to the parent.
+     */
+    void
+    step();
+
+    /**
+     *  Replace the parent cells of the patch by their blocks on the child, as
+     *  well as the surface geopotential if asked.
+     */
+    void
+    feedback(bool withSurfaceGeopotential = false);
+
+    BarotropicModel_A_ImplicitMidpoint&
+    childModel() {
+        return *child;
+    }
+
+    /**
+     *  Return the index of the current time level of the child, which is
+     *  stepped by integrate() directly.
+     */
+    const TimeLevelIndex<2>&
+    childTimeIdx() const {
+        return _childTimeIdx;
+    }
+private:
+    Stencil
+    calcStencil(int i, int j) const;
+
+    double
+    interpolate(const Field<double, 2> &field, const TimeLevelIndex<2> &timeIdx,
+                const Stencil &stencil) const;
+
+    double
+    interpolate(const Field<double> &field, const Stencil &stencil) const;
+
+    void
+    interpolateBoundary(vector<double> &u, vector<double> &v,
+                        vector<double> &gd) const;
+
+    void
+    setBoundary(const TimeLevelIndex<2> &timeIdx, double weight);
+}; // NestedRefinement
+
+} // barotropic_model
+
+#endif // __NestedRefinement__
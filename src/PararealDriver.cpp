@@ -0,0 +1,318 @@
+#include "PararealDriver.h"
+#include "BoundaryExchange.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace barotropic_model {
+
+PararealDriver::PararealDriver() {
+    numSlice = 4;
+    numThread = std::max(1u, std::thread::hardware_concurrency());
+    coarseStepRatio = 4;
+    coarseMaxIteration = 2;
+    coarseMeshRatio = 2;
+    tolerance = 1.0e-8;
+    coarseModel = NULL;
+    REPORT_ONLINE;
+}
+
+PararealDriver::~PararealDriver() {
+    for (int i = 0; i < fineModels.size(); ++i) {
+        delete fineModels[i];
+    }
+    if (coarseModel != NULL) {
+        delete coarseModel;
+    }
+    REPORT_OFFLINE;
+}
+
+void PararealDriver::
+setNumSlice(int numSlice) {
+    if (numSlice < 1) {
+        REPORT_ERROR("Slice number must be positive!");
+    }
+    this->numSlice = numSlice;
+} // setNumSlice
+
+void PararealDriver::
+setNumThread(int numThread) {
+    if (numThread < 1) {
+        REPORT_ERROR("Thread number must be positive!");
+    }
+    this->numThread = numThread;
+} // setNumThread
+
+void PararealDriver::
+setCoarsePropagator(int coarseStepRatio, int coarseMaxIteration,
+                    int coarseMeshRatio) {
+    if (coarseStepRatio < 1 || coarseMaxIteration < 1 || coarseMeshRatio < 1) {
+        REPORT_ERROR("Invalid coarse propagator settings!");
+    }
+    this->coarseStepRatio = coarseStepRatio;
+    this->coarseMaxIteration = coarseMaxIteration;
+    this->coarseMeshRatio = coarseMeshRatio;
+} // setCoarsePropagator
+
+void PararealDriver::
+run(BarotropicModel_A_ImplicitMidpoint &model, int numStep, double dt) {
+    if (numStep%(numSlice*coarseStepRatio) != 0) {
+        REPORT_ERROR("Step number " << numStep << " is not divisible by " <<
+                     "slice number times coarse step ratio (" <<
+                     numSlice*coarseStepRatio << ")!");
+    }
+    typedef std::chrono::steady_clock Clock;
+    int numSliceStep = numStep/numSlice;
+    int numWorker = std::min(numThread, numSlice);
+    TimeLevelIndex<2> initTimeIdx;
+    Clock::time_point startTime = Clock::now();
+    createModels(model);
+    // U[n] are the slice boundary states, F[n] and G[n] are the fine and
+    // coarse propagations of U[n-1] of the last iteration.
+    vector<State> U(numSlice+1), F(numSlice+1), G(numSlice+1);
+    getState(model, initTimeIdx, U[0]);
+    F[0] = G[0] = U[0];
+    // Initial coarse prediction.
+    for (int n = 1; n <= numSlice; ++n) {
+        propagateCoarse(U[n-1], numSliceStep/coarseStepRatio,
+                        dt*coarseStepRatio, G[n]);
+        U[n] = G[n];
+    }
+    int k;
+    for (k = 1; k <= numSlice; ++k) {
+        // Run the fine propagator over the unconverged slices concurrently.
+        // Note: The first k-1 slices are exact after k-1 iterations.
+        std::atomic<int> nextSlice(k);
+        vector<std::thread> workers;
+        for (int w = 0; w < numWorker; ++w) {
+            workers.push_back(std::thread([&, w] () {
+#ifdef _OPENMP
+                omp_set_num_threads(1);
+#endif
+                for (int n = nextSlice++; n <= numSlice; n = nextSlice++) {
+                    propagate(*fineModels[w], U[n-1], numSliceStep, dt, F[n]);
+                }
+            }));
+        }
+        for (int w = 0; w < numWorker; ++w) {
+            workers[w].join();
+        }
+        // Correct the slice boundary states serially.
+        double change = 0;
+        State coarse;
+        for (int n = k; n <= numSlice; ++n) {
+            State corrected;
+            if (n == k) {
+                // The start of this slice is exact, so is its fine end.
+                corrected = F[n];
+            } else {
+                propagateCoarse(U[n-1], numSliceStep/coarseStepRatio,
+                                dt*coarseStepRatio, coarse);
+                corrected = coarse;
+                for (int l = 0; l < corrected.gd.size(); ++l) {
+                    corrected.u[l] += F[n].u[l]-G[n].u[l];
+                    corrected.v[l] += F[n].v[l]-G[n].v[l];
+                    corrected.gd[l] += F[n].gd[l]-G[n].gd[l];
+                }
+                G[n] = coarse;
+            }
+            double sliceChange = calcRelativeChange(corrected, U[n]);
+            if (!std::isfinite(sliceChange)) {
+                REPORT_ERROR("Parareal iteration blows up at slice " << n <<
+                             ", try a more stable coarse propagator!");
+            }
+            change = std::max(change, sliceChange);
+            U[n] = corrected;
+        }
+        double wallTime = std::chrono::duration<double>(Clock::now()-startTime).count();
+        cout << "parareal iteration " << setw(3) << k << "  ";
+        cout << "correction: " << std::scientific << setprecision(4) << change << "  ";
+        cout << "wall time: " << std::fixed << setprecision(3) << wallTime << " s" << endl;
+        if (change < tolerance) {
+            break;
+        }
+    }
+    if (k > numSlice) {
+        REPORT_NOTICE("Parareal iterations reach the slice number, so the " <<
+                      "result equals the serial fine one.");
+    }
+    setState(U[numSlice], initTimeIdx, model);
+} // run
+
+void PararealDriver::
+createModels(BarotropicModel_A_ImplicitMidpoint &model) {
+    numLon = model.mesh().numGrid(0, FULL);
+    numLat = model.mesh().numGrid(1, FULL);
+    if (numLon%coarseMeshRatio != 0 || (numLat-1)%coarseMeshRatio != 0) {
+        REPORT_ERROR("Mesh size " << numLon << "x" << numLat << " can not " <<
+                     "be coarsened by " << coarseMeshRatio << "!");
+    }
+    // Note: The time managers are only held by the models, and the driver
+    //       passes the time step to integrate() directly.
+    fineTimeManager.init(ptime(date(2000, 1, 1)), ptime(date(2000, 1, 2)), minutes(1));
+    coarseTimeManager.init(ptime(date(2000, 1, 1)), ptime(date(2000, 1, 2)), minutes(1));
+    int numWorker = std::min(numThread, numSlice);
+    for (int w = fineModels.size(); w < numWorker; ++w) {
+        BarotropicModel_A_ImplicitMidpoint *fineModel = new BarotropicModel_A_ImplicitMidpoint;
+        fineModel->setLeanMemory(model.isLeanMemory());
+        fineModel->setReducedGrid(model.isReducedGrid());
+        fineModel->init(fineTimeManager, numLon, numLat);
+        fineModel->setVerbose(false);
+        fineModels.push_back(fineModel);
+    }
+    if (coarseModel == NULL) {
+        coarseModel = new BarotropicModel_A_ImplicitMidpoint;
+        coarseModel->setReducedGrid(model.isReducedGrid());
+        coarseModel->init(coarseTimeManager, numLon/coarseMeshRatio,
+                          (numLat-1)/coarseMeshRatio+1);
+    }
+    coarseModel->setMaxIteration(coarseMaxIteration);
+    coarseModel->setVerbose(false);
+    // Copy the surface geopotential through the views, since the models may
+    // have been stepped by an earlier run.
+    vector<BarotropicModel*> models(fineModels.begin(), fineModels.end());
+    FieldView ghs(model.surfaceGeopotential());
+    for (int m = 0; m < models.size(); ++m) {
+        FieldView fineGhs = models[m]->surfaceGeopotentialView();
+        for (int j = 0; j < ghs.numLat(); ++j) {
+            for (int i = 0; i < ghs.numLon(); ++i) {
+                fineGhs(i, j) = ghs(i, j);
+            }
+        }
+        BoundaryExchange::run({&models[m]->surfaceGeopotential()});
+    }
+    FieldView coarseGhs = coarseModel->surfaceGeopotentialView();
+    for (int j = 0; j < coarseGhs.numLat(); ++j) {
+        for (int i = 0; i < coarseGhs.numLon(); ++i) {
+            coarseGhs(i, j) = ghs(i*coarseMeshRatio, j*coarseMeshRatio);
+        }
+    }
+    BoundaryExchange::run({&coarseModel->surfaceGeopotential()});
+} // createModels
+
+void PararealDriver::
+propagate(BarotropicModel_A_ImplicitMidpoint &model, const State &start,
+          int numStep, double dt, State &end) {
+    TimeLevelIndex<2> timeIdx;
+    setState(start, timeIdx, model);
+    for (int step = 0; step < numStep; ++step) {
+        model.integrate(timeIdx, dt);
+        timeIdx.shift();
+    }
+    getState(model, timeIdx, end);
+} // propagate
+
+void PararealDriver::
+propagateCoarse(const State &start, int numStep, double dt, State &end) {
+    if (coarseMeshRatio == 1) {
+        propagate(*coarseModel, start, numStep, dt, end);
+    } else {
+        restrictState(start, coarseStart);
+        propagate(*coarseModel, coarseStart, numStep, dt, coarseEnd);
+        prolongState(coarseEnd, end);
+    }
+} // propagateCoarse
+
+void PararealDriver::
+restrictState(const State &fine, State &coarse) const {
+    int numCoarseLon = numLon/coarseMeshRatio;
+    int numCoarseLat = (numLat-1)/coarseMeshRatio+1;
+    coarse.u.resize(numCoarseLon*numCoarseLat);
+    coarse.v.resize(numCoarseLon*numCoarseLat);
+    coarse.gd.resize(numCoarseLon*numCoarseLat);
+    for (int j = 0; j < numCoarseLat; ++j) {
+        for (int i = 0; i < numCoarseLon; ++i) {
+            int l = j*numCoarseLon+i;
+            int k = j*coarseMeshRatio*numLon+i*coarseMeshRatio;
+            coarse.u[l] = fine.u[k];
+            coarse.v[l] = fine.v[k];
+            coarse.gd[l] = fine.gd[k];
+        }
+    }
+} // restrictState
+
+void PararealDriver::
+prolongState(const State &coarse, State &fine) const {
+    int numCoarseLon = numLon/coarseMeshRatio;
+    int numCoarseLat = (numLat-1)/coarseMeshRatio+1;
+    fine.u.resize(numLon*numLat);
+    fine.v.resize(numLon*numLat);
+    fine.gd.resize(numLon*numLat);
+    for (int j = 0; j < numLat; ++j) {
+        int j0 = j/coarseMeshRatio, j1 = std::min(j0+1, numCoarseLat-1);
+        double wj = double(j%coarseMeshRatio)/coarseMeshRatio;
+        for (int i = 0; i < numLon; ++i) {
+            int i0 = i/coarseMeshRatio, i1 = (i0+1)%numCoarseLon;
+            double wi = double(i%coarseMeshRatio)/coarseMeshRatio;
+            int l00 = j0*numCoarseLon+i0, l01 = j0*numCoarseLon+i1;
+            int l10 = j1*numCoarseLon+i0, l11 = j1*numCoarseLon+i1;
+            double w00 = (1-wi)*(1-wj), w01 = wi*(1-wj);
+            double w10 = (1-wi)*wj, w11 = wi*wj;
+            int k = j*numLon+i;
+            fine.u[k] = w00*coarse.u[l00]+w01*coarse.u[l01]+
+                        w10*coarse.u[l10]+w11*coarse.u[l11];
+            fine.v[k] = w00*coarse.v[l00]+w01*coarse.v[l01]+
+                        w10*coarse.v[l10]+w11*coarse.v[l11];
+            fine.gd[k] = w00*coarse.gd[l00]+w01*coarse.gd[l01]+
+                         w10*coarse.gd[l10]+w11*coarse.gd[l11];
+        }
+    }
+} // prolongState
+
+void PararealDriver::
+getState(BarotropicModel &model, const TimeLevelIndex<2> &timeIdx,
+         State &state) {
+    const Mesh &mesh = model.mesh();
+    int numCell = mesh.numGrid(0, FULL)*mesh.numGrid(1, FULL);
+    state.u.resize(numCell);
+    state.v.resize(numCell);
+    state.gd.resize(numCell);
+    int l = 0;
+    for (int j = mesh.js(FULL); j <= mesh.je(FULL); ++j) {
+        for (int i = mesh.is(FULL); i <= mesh.ie(FULL); ++i) {
+            state.u[l] = model.zonalWind()(timeIdx, i, j);
+            state.v[l] = model.meridionalWind()(timeIdx, i, j);
+            state.gd[l] = model.geopotentialDepth()(timeIdx, i, j);
+            ++l;
+        }
+    }
+} // getState
+
+void PararealDriver::
+setState(const State &state, const TimeLevelIndex<2> &timeIdx,
+         BarotropicModel &model) {
+    const Mesh &mesh = model.mesh();
+    int l = 0;
+    for (int j = mesh.js(FULL); j <= mesh.je(FULL); ++j) {
+        for (int i = mesh.is(FULL); i <= mesh.ie(FULL); ++i) {
+            model.zonalWind()(timeIdx, i, j) = state.u[l];
+            model.meridionalWind()(timeIdx, i, j) = state.v[l];
+            model.geopotentialDepth()(timeIdx, i, j) = state.gd[l];
+            ++l;
+        }
+    }
+    BoundaryExchange::run(timeIdx, {&model.zonalWind(), &model.meridionalWind(),
+                                    &model.geopotentialDepth()});
+} // setState
+
+double PararealDriver::
+calcRelativeChange(const State &a, const State &b) {
+    double maxWind = 0, maxDiffWind = 0, maxGd = 0, maxDiffGd = 0;
+    for (int l = 0; l < a.gd.size(); ++l) {
+        if (!std::isfinite(a.u[l]+a.v[l]+a.gd[l]+b.u[l]+b.v[l]+b.gd[l])) {
+            return NAN;
+        }
+        maxWind = std::max(maxWind, std::max(fabs(a.u[l]), fabs(a.v[l])));
+        maxDiffWind = std::max(maxDiffWind, std::max(fabs(a.u[l]-b.u[l]),
+                                                     fabs(a.v[l]-b.v[l])));
+        maxGd = std::max(maxGd, fabs(a.gd[l]));
+        maxDiffGd = std::max(maxDiffGd, fabs(a.gd[l]-b.gd[l]));
+    }
+    return std::max(maxWind > 0 ? maxDiffWind/maxWind : maxDiffWind,
+                    maxGd > 0 ? maxDiffGd/maxGd : maxDiffGd);
+} // calcRelativeChange
+
+} // barotropic_model
@@ -0,0 +1,115 @@
+#ifndef __PararealDriver__
+#define __PararealDriver__
+
+#include "BarotropicModel_A_ImplicitMidpoint.h"
+
+namespace barotropic_model {
+
+/**
+ *  This class integrates a model in parallel in time by the parareal method.
+ *  The run is cut into time slices. The fine propagator F is the given model
+ *  itself (its time step and iterations), and it runs over all the slices
+ *  concurrently on separate threads, each with its own model instance. The
+ *  coarse propagator G is a copy of the model with a larger time step, fewer
+ *  fixed-point iterations and optionally a coarser mesh (every r-th grid
+ *  point, with bilinear interpolation back to the fine mesh), and it runs
+ *  through the slices serially. The slice boundary states are corrected by
+ *
+ *      Uₙ₊₁ᵏ = G(Uₙᵏ) + F(Uₙᵏ⁻¹) - G(Uₙᵏ⁻¹)
+ *
+ *  until the relative change of all the boundary states falls below the
+ *  tolerance, or the iteration number reaches the slice number, where the
+ *  result is exactly the serial fine one.
+ *
+ *  Each iteration prints the correction and the wall time since the start,
+ *  which can be compared with the wall time of a serial run for the speed-up.
+ *  (The times of the fine slices are not a serial reference, since they run
+ *  concurrently and share the memory bandwidth.)
+ *
+ *  Note: The worker threads run their models with one OpenMP thread each.
+ */
+class PararealDriver {
+public:
+    /**
+     *  The state on one slice boundary (cells without halo).
+     */
+    struct State {
+        vector<double> u, v, gd;
+    };
+protected:
+    int numSlice;
+    int numThread;
+    int coarseStepRatio;    //>! coarse time step / fine time step
+    int coarseMaxIteration; //>! fixed-point iterations of the coarse model
+    int coarseMeshRatio;    //>! fine grid interval / coarse grid interval
+    double tolerance;
+    int numLon, numLat;     //>! fine mesh size
+    TimeManager fineTimeManager, coarseTimeManager;
+    vector<BarotropicModel_A_ImplicitMidpoint*> fineModels;
+    BarotropicModel_A_ImplicitMidpoint *coarseModel;
+    State coarseStart, coarseEnd;
+public:
+    PararealDriver();
+    virtual ~PararealDriver();
+
+    void
+    setNumSlice(int numSlice);
+
+    void
+    setNumThread(int numThread);
+
+    /**
+     *  Set the coarse propagator. Its time step is coarseStepRatio times the
+     *  fine one, and its mesh takes every coarseMeshRatio-th grid point of
+     *  the fine mesh along each direction. Note that the fixed-point
+     *  iterations of the scheme are only stable for a small time step on the
+     *  fine mesh, so a larger coarse time step usually needs a coarser mesh.
+     */
+    void
+    setCoarsePropagator(int coarseStepRatio, int coarseMaxIteration,
+                        int coarseMeshRatio);
+
+    void
+    setTolerance(double tolerance) {
+        this->tolerance = tolerance;
+    }
+
+    /**
+     *  Integrate the model from its initial condition for the given number of
+     *  fine steps, and put the final state into the initial time level of the
+     *  model.
+     */
+    void
+    run(BarotropicModel_A_ImplicitMidpoint &model, int numStep, double dt);
+private:
+    void
+    createModels(BarotropicModel_A_ImplicitMidpoint &model);
+
+    void
+    propagate(BarotropicModel_A_ImplicitMidpoint &model, const State &start,
+              int numStep, double dt, State &end);
+
+    void
+    propagateCoarse(const State &start, int numStep, double dt, State &end);
+
+    void
+    restrictState(const State &fine, State &coarse) const;
+
+    void
+    prolongState(const State &coarse, State &fine) const;
+
+    static void
+    getState(BarotropicModel &model, const TimeLevelIndex<2> &timeIdx,
+             State &state);
+
+    static void
+    setState(const State &state, const TimeLevelIndex<2> &timeIdx,
+             BarotropicModel &model);
+
+    static double
+    calcRelativeChange(const State &a, const State &b);
+}; // PararealDriver
+
+} // barotropic_model
+
+#endif // __PararealDriver__
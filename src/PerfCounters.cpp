@@ -0,0 +1,241 @@
+#include "PerfCounters.h"
+#include <cstdint>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+namespace barotropic_model {
+
+PerfCounters::PerfCounters() {
+    _isEnabled = false;
+    hasCounters = false;
+    peakBandwidth = 0;
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+    for (int k = fds.size()-1; k >= 0; --k) {
+        close(fds[k]);
+    }
+#endif
+}
+
+void PerfCounters::
+enable(double peakBandwidth) {
+    this->peakBandwidth = peakBandwidth;
+    _isEnabled = true;
+    if (hasCounters) return;
+#ifdef __linux__
+    // Start the OpenMP threads, and open the counters of all the threads.
+    #pragma omp parallel
+    {
+    }
+    DIR *dir = opendir("/proc/self/task");
+    hasCounters = dir != NULL;
+    while (hasCounters) {
+        struct dirent *entry = readdir(dir);
+        if (entry == NULL) break;
+        if (entry->d_name[0] == '.') continue;
+        hasCounters = openCounters(atoi(entry->d_name));
+    }
+    if (dir != NULL) closedir(dir);
+    if (!hasCounters) {
+        for (int k = 0; k < fds.size(); ++k) {
+            close(fds[k]);
+        }
+        fds.clear();
+    }
+#endif
+    if (!hasCounters) {
+        REPORT_WARNING("Hardware performance counters are not available, "
+                       "only wall time will be sampled.");
+    }
+} // enable
+
+int PerfCounters::
+addStage(const string &name, double flops) {
+    Stage stage;
+    stage.name = name;
+    stage.numCall = 0;
+    stage.seconds = 0;
+    stage.flops = flops;
+    for (int k = 0; k < NUM_COUNTER; ++k) {
+        stage.counts[k] = 0;
+    }
+    stages.push_back(stage);
+    return stages.size()-1;
+} // addStage
+
+void PerfCounters::
+setStageFlops(int stageIdx, double flops) {
+    stages[stageIdx].flops = flops;
+} // setStageFlops
+
+void PerfCounters::
+start() {
+    readCounters(startCounts);
+    startTime = Clock::now();
+} // start
+
+void PerfCounters::
+stop(int stageIdx) {
+    Clock::time_point endTime = Clock::now();
+    double endCounts[NUM_COUNTER];
+    readCounters(endCounts);
+    Stage &stage = stages[stageIdx];
+    stage.numCall++;
+    stage.seconds += std::chrono::duration<double>(endTime-startTime).count();
+    for (int k = 0; k < NUM_COUNTER; ++k) {
+        stage.counts[k] += endCounts[k]-startCounts[k];
+    }
+} // stop
+
+void PerfCounters::
+reset() {
+    for (int s = 0; s < stages.size(); ++s) {
+        stages[s].numCall = 0;
+        stages[s].seconds = 0;
+        for (int k = 0; k < NUM_COUNTER; ++k) {
+            stages[s].counts[k] = 0;
+        }
+    }
+} // reset
+
+/**
+ *  Open and start a counter group of the given thread.
+ */
+bool PerfCounters::
+openCounters(int tid) {
+#ifdef __linux__
+    const uint64_t configs[NUM_COUNTER] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_REFERENCES,
+        PERF_COUNT_HW_CACHE_MISSES
+    };
+    int leader = -1;
+    for (int k = 0; k < NUM_COUNTER; ++k) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[k];
+        attr.disabled = k == 0; // The group leader starts the whole group.
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED|
+                           PERF_FORMAT_TOTAL_TIME_RUNNING;
+        int fd = syscall(__NR_perf_event_open, &attr, tid, -1, leader, 0);
+        if (fd == -1) return false;
+        fds.push_back(fd);
+        if (k == 0) leader = fd;
+    }
+    ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return true;
+#else
+    return false;
+#endif
+} // openCounters
+
+/**
+ *  Read the counts summed over the threads.
+ */
+bool PerfCounters::
+readCounters(double *counts) const {
+    for (int k = 0; k < NUM_COUNTER; ++k) {
+        counts[k] = 0;
+    }
+    if (!hasCounters) return false;
+#ifdef __linux__
+    for (int l = 0; l < fds.size(); ++l) {
+        // value, time enabled, time running
+        uint64_t buffer[3];
+        if (read(fds[l], buffer, sizeof(buffer)) != sizeof(buffer)) {
+            return false;
+        }
+        // Scale the value when the counters are multiplexed.
+        counts[l%NUM_COUNTER] += buffer[2] == 0 ? 0 :
+            double(buffer[0])*buffer[1]/buffer[2];
+    }
+    return true;
+#else
+    return false;
+#endif
+} // readCounters
+
+/**
+ *  For each stage, the report contains:
+ *
+ *  - time per call (ms) and share of the sampled time,
+ *  - GFLOP/s achieved by the estimated FLOPs of the stage,
+ *  - IPC, LLC miss ratio and the DRAM bandwidth implied by LLC misses (64 bytes
+ *    per miss) with its fraction of the peak bandwidth, and the arithmetic
+ *    intensity of the estimated FLOPs over the LLC-miss bytes (FLOPs/byte),
+ *    when the hardware counters are available.
+ *
+ *  The columns of the estimated FLOPs are left as "-" for the stages without
+ *  an estimate.
+ */
+void PerfCounters::
+report(std::ostream &os) const {
+    os << fixed << "Performance report";
+    if (peakBandwidth > 0) {
+        os << " (peak: " << setprecision(1) << peakBandwidth << " GB/s)";
+    }
+    os << endl;
+    os << std::left << setw(32) << "stage" << std::right;
+    os << setw(8) << "calls" << setw(12) << "ms/call" << setw(8) << "time%";
+    os << setw(10) << "GFLOP/s";
+    if (hasCounters) {
+        os << setw(8) << "IPC" << setw(10) << "LLC-miss" << setw(12) << "LLC GB/s";
+        os << setw(8) << "peak%" << setw(10) << "FLOP/B";
+    }
+    os << endl;
+    double totalSeconds = 0;
+    for (int s = 0; s < stages.size(); ++s) {
+        totalSeconds += stages[s].seconds;
+    }
+    for (int s = 0; s < stages.size(); ++s) {
+        const Stage &stage = stages[s];
+        if (stage.numCall == 0) continue;
+        os << std::left << setw(32) << stage.name << std::right;
+        os << setw(8) << stage.numCall;
+        os << setw(12) << setprecision(4) << stage.seconds/stage.numCall*1.0e3;
+        os << setw(8) << setprecision(1) << (totalSeconds > 0 ? stage.seconds/totalSeconds*100 : 0);
+        double flops = stage.flops*stage.numCall;
+        if (flops > 0 && stage.seconds > 0) {
+            os << setw(10) << setprecision(3) << flops/stage.seconds*1.0e-9;
+        } else {
+            os << setw(10) << "-";
+        }
+        if (hasCounters) {
+            double cycles = stage.counts[CYCLES];
+            double refs = stage.counts[CACHE_REFERENCES];
+            double misses = stage.counts[CACHE_MISSES];
+            double gbytes = stage.seconds > 0 ? misses*64/stage.seconds*1.0e-9 : 0;
+            os << setw(8) << setprecision(2) << (cycles > 0 ? stage.counts[INSTRUCTIONS]/cycles : 0);
+            os << setw(10) << setprecision(3) << (refs > 0 ? misses/refs : 0);
+            os << setw(12) << setprecision(3) << gbytes;
+            if (peakBandwidth > 0) {
+                os << setw(8) << setprecision(1) << gbytes/peakBandwidth*100;
+            } else {
+                os << setw(8) << "-";
+            }
+            if (flops > 0 && misses > 0) {
+                os << setw(10) << setprecision(3) << flops/(misses*64);
+            } else {
+                os << setw(10) << "-";
+            }
+        }
+        os << endl;
+    }
+    os << "Total sampled time: " << setprecision(3) << totalSeconds << " s" << endl;
+} // report
+
+} // barotropic_model
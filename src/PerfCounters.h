@@ -0,0 +1,125 @@
+#ifndef __PerfCounters__
+#define __PerfCounters__
+
+#include "barotropic_model_commons.h"
+#include <chrono>
+#include <ostream>
+
+namespace barotropic_model {
+
+/**
+ *  This class samples hardware performance counters (cycles, instructions,
+ *  last-level cache references and misses) around the stages of a model step
+ *  by using perf_event_open counter groups, and reports the wall time of each
+ *  stage with its IPC, LLC miss ratio and the DRAM bandwidth implied by the
+ *  LLC misses, which is compared with the machine peak bandwidth given by the
+ *  user (the bandwidth roof of a memory-bound stencil). A stage can also carry
+ *  the FLOPs of one call estimated by its model, which give the achieved
+ *  GFLOP/s and, over the LLC-miss bytes, the arithmetic intensity (FLOPs/byte)
+ *  for the roofline.
+ *
+ *  One counter group is opened for each thread of the process when the
+ *  sampling is enabled (after starting the OpenMP team), including the task
+ *  graph threads, and the counts of a stage are summed over the threads.
+ *  Threads started later are not counted. When the counters can not be opened
+ *  (e.g. restricted by perf_event_paranoid), only wall time is reported.
+ */
+class PerfCounters {
+public:
+    enum CounterType {
+        CYCLES = 0, INSTRUCTIONS, CACHE_REFERENCES, CACHE_MISSES, NUM_COUNTER
+    };
+
+    struct Stage {
+        string name;
+        long numCall;
+        double seconds;
+        double flops;               //>! estimated FLOPs of one call (zero if unknown)
+        double counts[NUM_COUNTER]; //>! summed over the threads
+    };
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    bool _isEnabled;
+    bool hasCounters;
+    vector<int> fds;        //>! NUM_COUNTER counters of each thread
+    double peakBandwidth;   //>! machine peak memory bandwidth (GB/s)
+    vector<Stage> stages;
+    // Snapshot taken when the current stage starts.
+    Clock::time_point startTime;
+    double startCounts[NUM_COUNTER];
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    /**
+     *  Turn on the sampling. The peak bandwidth is used for the report, and
+     *  can be zero if unknown.
+     */
+    void
+    enable(double peakBandwidth = 0);
+
+    bool
+    isEnabled() const {
+        return _isEnabled;
+    }
+
+    int
+    addStage(const string &name, double flops = 0);
+
+    /**
+     *  Set the estimated FLOPs of one call of the stage, e.g. when the cells
+     *  computed by the stage have been changed.
+     */
+    void
+    setStageFlops(int stageIdx, double flops);
+
+    const Stage&
+    stage(int stageIdx) const {
+        return stages[stageIdx];
+    }
+
+    int
+    numStage() const {
+        return stages.size();
+    }
+
+    void
+    start();
+
+    void
+    stop(int stageIdx);
+
+    void
+    reset();
+
+    void
+    report(std::ostream &os) const;
+private:
+    bool
+    openCounters(int tid);
+
+    bool
+    readCounters(double *counts) const;
+}; // PerfCounters
+
+/**
+ *  This class samples one stage within its lifetime.
+ */
+class PerfStage {
+    PerfCounters &perf;
+    int stageIdx;
+public:
+    PerfStage(PerfCounters &perf, int stageIdx)
+    : perf(perf), stageIdx(stageIdx) {
+        if (perf.isEnabled()) perf.start();
+    }
+
+    ~PerfStage() {
+        if (perf.isEnabled()) perf.stop(stageIdx);
+    }
+}; // PerfStage
+
+} // barotropic_model
+
+#endif // __PerfCounters__
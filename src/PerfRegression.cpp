@@ -0,0 +1,323 @@
+#include "PerfRegression.h"
+#include "Autotuner.h"
+#include "RossbyHaurwitzTestCase.h"
+#include "ToyTestCase.h"
+#include <fstream>
+#include <sstream>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace barotropic_model {
+
+PerfRegression::PerfRegression(const string &baselineFileName) {
+    this->baselineFileName = baselineFileName;
+    numWarmupStep = 5;
+    numRepeat = 3;
+    timeTolerance = 0.2;
+    iterationTolerance = 0.1;
+    conservationTolerance = 1.0e-10;
+    REPORT_ONLINE;
+}
+
+PerfRegression::~PerfRegression() {
+    REPORT_OFFLINE;
+}
+
+void PerfRegression::
+addDefaultCases(int numStep) {
+    std::ostringstream suffix;
+    suffix << "-" << numStep;
+    Case c;
+    c.numLon = 80;
+    c.numLat = 41;
+    c.dt = 240;
+    c.numStep = numStep;
+    c.name = "rossby-haurwitz-full"+suffix.str();
+    c.testCase = "rossby-haurwitz";
+    c.variant = "full";
+    addCase(c);
+    c.name = "rossby-haurwitz-lean"+suffix.str();
+    c.variant = "lean";
+    addCase(c);
+    c.name = "toy-full"+suffix.str();
+    c.testCase = "toy";
+    c.variant = "full";
+    addCase(c);
+} // addDefaultCases
+
+void PerfRegression::
+addCase(const Case &c) {
+    if (c.testCase != "rossby-haurwitz" && c.testCase != "toy") {
+        REPORT_ERROR("Unknown test case \"" << c.testCase << "\"!");
+    }
+    if (c.variant != "full" && c.variant != "lean") {
+        REPORT_ERROR("Unknown variant \"" << c.variant << "\"!");
+    }
+    if (c.numStep < 1) {
+        REPORT_ERROR("Step number must be positive!");
+    }
+    cases.push_back(c);
+} // addCase
+
+void PerfRegression::
+setNumStep(int numWarmupStep, int numRepeat) {
+    if (numWarmupStep < 0 || numRepeat < 1) {
+        REPORT_ERROR("Invalid warm-up step or repeat numbers!");
+    }
+    this->numWarmupStep = numWarmupStep;
+    this->numRepeat = numRepeat;
+} // setNumStep
+
+void PerfRegression::
+setTolerance(double timeTolerance, double iterationTolerance,
+             double conservationTolerance) {
+    if (timeTolerance <= 0 || iterationTolerance < 0 ||
+        conservationTolerance <= 0) {
+        REPORT_ERROR("Invalid tolerances!");
+    }
+    this->timeTolerance = timeTolerance;
+    this->iterationTolerance = iterationTolerance;
+    this->conservationTolerance = conservationTolerance;
+} // setTolerance
+
+PerfRegression::Status PerfRegression::
+run(bool updateBaseline) {
+    string key = machineKey();
+    std::map<string, double> baseline;
+    if (!updateBaseline) {
+        baseline = readBaseline(key);
+    }
+    bool isSkipped = baseline.empty() && !updateBaseline;
+    if (isSkipped) {
+        REPORT_NOTICE("No baseline of this machine in \"" << baselineFileName <<
+                      "\", so only the conservation is checked. Store one " <<
+                      "by updating the baseline.");
+    }
+    vector<Result> results;
+    bool isPassed = true;
+    for (int i = 0; i < cases.size(); ++i) {
+        results.push_back(runCase(cases[i]));
+        if (!compare(cases[i], results.back(), baseline)) {
+            isPassed = false;
+        }
+    }
+    if (updateBaseline) {
+        writeBaseline(key, results);
+    }
+    if (!isPassed) {
+        return FAILED;
+    }
+    return isSkipped ? SKIPPED : PASSED;
+} // run
+
+PerfRegression::Result PerfRegression::
+runCase(const Case &c) const {
+    BarotropicModel_A_ImplicitMidpoint model;
+    TimeManager timeManager;
+    ptime startTime(date(2000, 1, 1));
+    int numTotalStep = numWarmupStep+numRepeat*c.numStep;
+    timeManager.init(startTime, startTime+seconds(int(c.dt)*numTotalStep),
+                     seconds(int(c.dt)));
+    model.setLeanMemory(c.variant == "lean");
+    model.setVerbose(false);
+    model.init(timeManager, c.numLon, c.numLat);
+    if (c.testCase == "rossby-haurwitz") {
+        RossbyHaurwitzTestCase testCase;
+        testCase.calcInitCond(model);
+    } else {
+        ToyTestCase testCase;
+        testCase.calcInitCond(model);
+    }
+    model.initialize();
+    double e0 = model.totalEnergy();
+    double m0 = model.totalMass();
+    if (numWarmupStep > 0) {
+        model.step(numWarmupStep);
+    }
+    // Take the fastest repeat of each stage, which is the least disturbed by
+    // the other loads of the machine.
+    PerfCounters &perf = model.perfCounters();
+    perf.enable();
+    Result result;
+    result.stepTime = 0;
+    result.instructionsPerStep = 0;
+    result.stageNames.resize(perf.numStage());
+    result.stageTimes.resize(perf.numStage(), 0);
+    int numIteration = 0;
+    for (int r = 0; r < numRepeat; ++r) {
+        typedef std::chrono::steady_clock Clock;
+        perf.reset();
+        Clock::time_point t0 = Clock::now();
+        for (int k = 0; k < c.numStep; ++k) {
+            model.step();
+            numIteration += model.numIteration();
+        }
+        double stepTime = std::chrono::duration<double>(Clock::now()-t0).count()/c.numStep;
+        if (r == 0 || stepTime < result.stepTime) {
+            result.stepTime = stepTime;
+        }
+        double numInstruction = 0;
+        for (int s = 0; s < perf.numStage(); ++s) {
+            double stageTime = perf.stage(s).seconds/c.numStep;
+            result.stageNames[s] = perf.stage(s).name;
+            if (r == 0 || stageTime < result.stageTimes[s]) {
+                result.stageTimes[s] = stageTime;
+            }
+            numInstruction += perf.stage(s).counts[PerfCounters::INSTRUCTIONS];
+        }
+        numInstruction /= c.numStep;
+        if (r == 0 || numInstruction < result.instructionsPerStep) {
+            result.instructionsPerStep = numInstruction;
+        }
+    }
+    result.iterationsPerStep = double(numIteration)/(numRepeat*c.numStep);
+    result.energy = model.totalEnergy();
+    result.mass = model.totalMass();
+    result.energyDrift = fabs(result.energy-e0)/e0;
+    result.massDrift = fabs(result.mass-m0)/m0;
+    return result;
+} // runCase
+
+/**
+ *  Check the result against the baseline (none if empty), and print the
+ *  metrics with their changes from the baseline.
+ */
+bool PerfRegression::
+compare(const Case &c, const Result &result,
+        const std::map<string, double> &baseline) const {
+    bool isPassed = true;
+    cout << "Case " << c.name << " (" << c.testCase << ", " << c.variant <<
+        ", " << c.numLon << "x" << c.numLat << ", dt " << c.dt << "):" << endl;
+    cout << std::left << setw(40) << "  metric" << std::right <<
+        setw(16) << "baseline" << setw(16) << "current" << setw(10) <<
+        "delta" << endl;
+    // Print one metric, and fail it if it grows by more than the tolerance.
+    auto check = [&] (const string &metric, double value, double tolerance) {
+        std::map<string, double>::const_iterator it =
+            baseline.find(c.name+"\t"+metric);
+        cout << std::left << setw(40) << "  "+metric << std::right <<
+            std::scientific << setprecision(6);
+        if (it == baseline.end()) {
+            cout << setw(16) << "-" << setw(16) << value << endl;
+            cout << std::defaultfloat;
+            return;
+        }
+        double delta = (value-it->second)/fabs(it->second);
+        cout << setw(16) << it->second << setw(16) << value <<
+            fixed << setprecision(1) << setw(9) << delta*100 << "%";
+        if (tolerance >= 0 && delta > tolerance) {
+            cout << "  REGRESSED";
+            isPassed = false;
+        }
+        cout << std::defaultfloat << setprecision(6) << endl;
+    };
+    check("energy", result.energy, -1);
+    check("mass", result.mass, -1);
+    check("iterations-per-step", result.iterationsPerStep, iterationTolerance);
+    check("seconds-per-step", result.stepTime, timeTolerance);
+    if (result.instructionsPerStep > 0) {
+        check("instructions-per-step", result.instructionsPerStep, timeTolerance);
+    }
+    for (int s = 0; s < result.stageNames.size(); ++s) {
+        check("stage:"+result.stageNames[s], result.stageTimes[s], timeTolerance);
+    }
+    // Check the conservation.
+    if (result.energyDrift > conservationTolerance ||
+        result.massDrift > conservationTolerance) {
+        REPORT_WARNING("Case " << c.name << " drifts by " <<
+                       result.energyDrift << " in energy and " <<
+                       result.massDrift << " in mass!");
+        isPassed = false;
+    }
+    const char *names[] = {"energy", "mass"};
+    double values[] = {result.energy, result.mass};
+    for (int k = 0; k < 2; ++k) {
+        std::map<string, double>::const_iterator it =
+            baseline.find(c.name+"\t"+names[k]);
+        if (it != baseline.end() &&
+            fabs(values[k]-it->second) > conservationTolerance*fabs(it->second)) {
+            REPORT_WARNING("Case " << c.name << " deviates from the baseline " <<
+                           names[k] << "!");
+            isPassed = false;
+        }
+    }
+    cout << "  " << (isPassed ? "passed" : "FAILED") << endl;
+    return isPassed;
+} // compare
+
+string PerfRegression::
+machineKey() const {
+    int numThread = 1;
+#ifdef _OPENMP
+    numThread = omp_get_max_threads();
+#endif
+    std::ostringstream key;
+    key << Autotuner::cpuModel() << "\t" << numThread;
+    return key.str();
+} // machineKey
+
+std::map<string, double> PerfRegression::
+readBaseline(const string &key) const {
+    std::map<string, double> baseline;
+    std::ifstream file(baselineFileName.c_str());
+    string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        if (line.compare(0, key.size()+1, key+"\t") != 0) continue;
+        // The rest is the case, the metric and the value.
+        string rest = line.substr(key.size()+1);
+        string::size_type pos = rest.rfind('\t');
+        if (pos == string::npos || rest.find('\t') == pos) {
+            REPORT_WARNING("Ignore the bad baseline line \"" << line << "\"!");
+            continue;
+        }
+        baseline[rest.substr(0, pos)] = atof(rest.c_str()+pos+1);
+    }
+    return baseline;
+} // readBaseline
+
+void PerfRegression::
+writeBaseline(const string &key, const vector<Result> &results) const {
+    // Keep the baselines of the other machines.
+    vector<string> lines;
+    {
+        std::ifstream file(baselineFileName.c_str());
+        string line;
+        while (std::getline(file, line)) {
+            if (line.compare(0, key.size()+1, key+"\t") != 0) {
+                lines.push_back(line);
+            }
+        }
+    }
+    if (lines.empty()) {
+        lines.push_back("# cpu-model\tthreads\tcase\tmetric\tvalue");
+    }
+    std::ofstream file(baselineFileName.c_str());
+    if (!file) {
+        REPORT_ERROR("Failed to write the baseline \"" << baselineFileName << "\"!");
+    }
+    for (int i = 0; i < lines.size(); ++i) {
+        file << lines[i] << endl;
+    }
+    file << setprecision(17);
+    for (int i = 0; i < results.size(); ++i) {
+        const Result &result = results[i];
+        string prefix = key+"\t"+cases[i].name+"\t";
+        file << prefix << "energy\t" << result.energy << endl;
+        file << prefix << "mass\t" << result.mass << endl;
+        file << prefix << "iterations-per-step\t" << result.iterationsPerStep << endl;
+        file << prefix << "seconds-per-step\t" << result.stepTime << endl;
+        if (result.instructionsPerStep > 0) {
+            file << prefix << "instructions-per-step\t" <<
+                result.instructionsPerStep << endl;
+        }
+        for (int s = 0; s < result.stageNames.size(); ++s) {
+            file << prefix << "stage:" << result.stageNames[s] << "\t" <<
+                result.stageTimes[s] << endl;
+        }
+    }
+    REPORT_NOTICE("Store the baseline into \"" << baselineFileName << "\".");
+} // writeBaseline
+
+} // barotropic_model
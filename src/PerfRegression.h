@@ -0,0 +1,131 @@
+#ifndef __PerfRegression__
+#define __PerfRegression__
+
+#include "BarotropicModel_A_ImplicitMidpoint.h"
+#include <map>
+
+namespace barotropic_model {
+
+/**
+ *  This class runs fixed model configurations for a set number of steps and
+ *  compares their conservation and cost with the baselines stored in a file,
+ *  so that a regression of the throughput (e.g. after upgrading geomtk or the
+ *  compiler) is caught by the tests instead of in production.
+ *
+ *  For each case, the wall time per step and of each stage of the step (see
+ *  PerfCounters) is the minimum over several repeats of the steps, which are
+ *  run after a few warm-up steps. The stage times are taken around the whole
+ *  parallel loops, so they cover all the threads, and so do the instructions
+ *  per step, which are summed over the threads when the hardware counters
+ *  are available. A case fails when
+ *
+ *  - the relative drift of the total energy or mass, or its relative
+ *    deviation from the baseline at the end, is beyond the conservation
+ *    tolerance,
+ *  - the mean number of fixed-point iterations per step grows by more than
+ *    the iteration tolerance (relative),
+ *  - the time per step or of any stage, or the instructions per step, grow
+ *    by more than the time tolerance (relative).
+ *
+ *  The baselines are machine specific, so they are keyed by the CPU model
+ *  and the number of threads. Even the final energy and mass differ in the
+ *  last bits with the compiler, geomtk and the order of the reductions over
+ *  the threads, so no baseline is shared across machines. Each baseline line
+ *  has the tab-separated columns
+ *
+ *      cpu-model  threads  case  metric  value
+ *
+ *  where the metric is "energy", "mass", "iterations-per-step",
+ *  "seconds-per-step", "instructions-per-step" or "stage:<stage name>"
+ *  (seconds per step). When the file has no baseline for this machine, only
+ *  the drifts of the energy and mass are checked and the run is reported as
+ *  skipped, until the baseline is stored by updating it.
+ */
+class PerfRegression {
+public:
+    struct Case {
+        string name;
+        string testCase;    //>! "rossby-haurwitz" or "toy"
+        string variant;     //>! "full" or "lean"
+        int numLon, numLat;
+        double dt;          //>! time step in seconds
+        int numStep;        //>! steps in one timed repeat
+    };
+
+    struct Result {
+        double energy, mass;            //>! totals at the end
+        double energyDrift, massDrift;  //>! relative to the initial condition
+        double iterationsPerStep;
+        double stepTime;                //>! seconds per step
+        double instructionsPerStep;     //>! over the threads (0 without counters)
+        vector<string> stageNames;
+        vector<double> stageTimes;      //>! seconds of each stage per step
+    };
+
+    enum Status {
+        PASSED = 0, FAILED, SKIPPED     //>! skipped without the timing baselines
+    };
+protected:
+    string baselineFileName;
+    vector<Case> cases;
+    int numWarmupStep;
+    int numRepeat;
+    double timeTolerance;
+    double iterationTolerance;
+    double conservationTolerance;
+public:
+    PerfRegression(const string &baselineFileName);
+    virtual ~PerfRegression();
+
+    /**
+     *  Add the default cases, which are the Rossby-Haurwitz wave in the full
+     *  and memory-lean modes and the toy test case with topography on the
+     *  80x41 mesh, each of the given number of steps per repeat. The step
+     *  number is a part of the case names, since the final energy and mass
+     *  depend on it.
+     */
+    void
+    addDefaultCases(int numStep = 30);
+
+    void
+    addCase(const Case &c);
+
+    void
+    setNumStep(int numWarmupStep, int numRepeat);
+
+    /**
+     *  Set the tolerances (20%, 10% and 1.0e-10 by default).
+     */
+    void
+    setTolerance(double timeTolerance, double iterationTolerance,
+                 double conservationTolerance);
+
+    /**
+     *  Run the cases, print the comparison with the baselines of this
+     *  machine, and return whether all the cases pass, or whether the timing
+     *  is skipped for the lack of the baselines. The baselines of this
+     *  machine are replaced by the results if asked.
+     */
+    Status
+    run(bool updateBaseline = false);
+private:
+    Result
+    runCase(const Case &c) const;
+
+    bool
+    compare(const Case &c, const Result &result,
+            const std::map<string, double> &baseline) const;
+
+    string
+    machineKey() const;
+
+    std::map<string, double>
+    readBaseline(const string &key) const;
+
+    void
+    writeBaseline(const string &key, const vector<Result> &results) const;
+}; // PerfRegression
+
+} // barotropic_model
+
+#endif // __PerfRegression__
@@ -0,0 +1,166 @@
+#include "PyramidOutput.h"
+#include "BoundaryExchange.h"
+#include <sstream>
+
+namespace barotropic_model {
+
+PyramidOutput::PyramidOutput() {
+    model = NULL;
+    interval = 0;
+    stepSize = 0;
+    numFrame = 0;
+    REPORT_ONLINE;
+}
+
+PyramidOutput::~PyramidOutput() {
+    for (int l = 0; l < levels.size(); ++l) {
+        delete levels[l]->mesh;
+        delete levels[l]->domain;
+        delete levels[l];
+    }
+    REPORT_OFFLINE;
+}
+
+void PyramidOutput::
+init(BarotropicModel &model, TimeManager &timeManager, int numLevel,
+     double interval, const string &prefix) {
+    this->model = &model;
+    this->interval = interval;
+    this->prefix = prefix;
+    stepSize = timeManager.stepSizeInSeconds();
+    io.init(timeManager);
+    // Set the area weights of the model cells.
+    // Note: The Pole cells are the caps within half of the grid interval.
+    const Mesh &mesh = model.mesh();
+    int numLon = mesh.numGrid(0, FULL);
+    int numLat = mesh.numGrid(1, FULL);
+    modelWeight.resize(numLat);
+    for (int j = 1; j < numLat-1; ++j) {
+        modelWeight[j] = mesh.cosLat(FULL, mesh.js(FULL)+j);
+    }
+    modelWeight[0] = mesh.cosLat(HALF, mesh.js(HALF))*0.25;
+    modelWeight[numLat-1] = mesh.cosLat(HALF, mesh.je(HALF))*0.25;
+    // Create the levels.
+    const vector<double> *fineWeight = &modelWeight;
+    for (int l = 1; l <= numLevel; ++l) {
+        if (numLon%2 != 0 || numLat%2 != 1 || numLat < 5) {
+            REPORT_WARNING("Mesh " << numLon << "x" << numLat << " can not " <<
+                           "be halved, so the pyramid stops at level " << l-1 << "!");
+            break;
+        }
+        numLon /= 2;
+        numLat = (numLat-1)/2+1;
+        Level *level = new Level;
+        level->domain = new Domain(2);
+        level->domain->radius() = model.domain().radius();
+        level->mesh = new Mesh(*level->domain);
+        level->mesh->init(numLon, numLat);
+        level->u.create("u", "m s-1", "zonal wind speed", *level->mesh, CENTER, 2);
+        level->v.create("v", "m s-1", "meridional wind speed", *level->mesh, CENTER, 2);
+        level->gd.create("gd", "m2 s-2", "geopotential depth", *level->mesh, CENTER, 2);
+        level->ghs.create("ghs", "m2 s-2", "surface geopotential", *level->mesh, CENTER, 2);
+        // A coarse cell takes the fine row on its center and half of each
+        // neighbor row, and two fine cells along the zonal direction.
+        level->weight.resize(numLat);
+        for (int j = 0; j < numLat; ++j) {
+            double w = (*fineWeight)[2*j];
+            if (j > 0) w += 0.5*(*fineWeight)[2*j-1];
+            if (j < numLat-1) w += 0.5*(*fineWeight)[2*j+1];
+            level->weight[j] = 2*w;
+        }
+        std::ostringstream pattern;
+        pattern << prefix << ".l" << l << ".%5s.nc";
+        level->fileIdx = io.addOutputFile(*level->mesh, StampString(pattern.str()),
+                                          seconds(int(interval)));
+        io.file(level->fileIdx).addField("double", FULL_DIMENSION,
+                                         {&level->u, &level->v, &level->gd, &level->ghs});
+        levels.push_back(level);
+        fineWeight = &level->weight;
+    }
+    // Write the header of the time index.
+    index.open((prefix+".index").c_str());
+    if (!index) {
+        REPORT_ERROR("Failed to open \"" << prefix << ".index\"!");
+    }
+    index << "# level 0: " << prefix << ".%5s.nc (" << mesh.numGrid(0, FULL) <<
+        "x" << mesh.numGrid(1, FULL) << ")" << endl;
+    for (int l = 0; l < levels.size(); ++l) {
+        index << "# level " << l+1 << ": " << prefix << ".l" << l+1 <<
+            ".%5s.nc (" << levels[l]->mesh->numGrid(0, FULL) << "x" <<
+            levels[l]->mesh->numGrid(1, FULL) << ")" << endl;
+    }
+    index << "# frame    step      seconds" << endl;
+    numFrame = 0;
+} // init
+
+void PyramidOutput::
+output(const TimeLevelIndex<2> &timeIdx, double elapsedSeconds) {
+    if (fmod(elapsedSeconds, interval) != 0) return;
+    BarotropicModel::StateView state = {
+        ConstFieldView(model->zonalWind(), timeIdx),
+        ConstFieldView(model->meridionalWind(), timeIdx),
+        ConstFieldView(model->geopotentialDepth(), timeIdx)
+    };
+    // Note: The view of the model would mark the surface geopotential as
+    //       changed, so it is read directly.
+    FieldView ghs(model->surfaceGeopotential());
+    for (int l = 0; l < levels.size(); ++l) {
+        Level &level = *levels[l];
+        if (l == 0) {
+            restrictField(state.u, modelWeight, FieldView(level.u), level.weight);
+            restrictField(state.v, modelWeight, FieldView(level.v), level.weight);
+            restrictField(state.gd, modelWeight, FieldView(level.gd), level.weight);
+            restrictField(ghs, modelWeight, FieldView(level.ghs), level.weight);
+        } else {
+            Level &fine = *levels[l-1];
+            restrictField(FieldView(fine.u), fine.weight, FieldView(level.u), level.weight);
+            restrictField(FieldView(fine.v), fine.weight, FieldView(level.v), level.weight);
+            restrictField(FieldView(fine.gd), fine.weight, FieldView(level.gd), level.weight);
+            restrictField(FieldView(fine.ghs), fine.weight, FieldView(level.ghs), level.weight);
+        }
+        BoundaryExchange::run({&level.u, &level.v, &level.gd, &level.ghs});
+        io.create(level.fileIdx);
+        io.output<double>(level.fileIdx, {&level.u, &level.v, &level.gd, &level.ghs});
+        io.close(level.fileIdx);
+    }
+    index << setw(7) << numFrame++ << " " << setw(7) <<
+        lround(elapsedSeconds/stepSize) << " " << setw(12) << std::fixed <<
+        setprecision(0) << elapsedSeconds << endl;
+} // output
+
+template <class FineView>
+void PyramidOutput::
+restrictField(const FineView &fine, const vector<double> &fineWeight,
+              FieldView coarse, const vector<double> &coarseWeight) {
+    int numFineLon = fine.numLon(), numFineLat = fine.numLat();
+    int numLon = coarse.numLon(), numLat = coarse.numLat();
+    #pragma omp parallel for
+    for (int j = 0; j < numLat; ++j) {
+        for (int i = 0; i < numLon; ++i) {
+            double sum = 0.0;
+            for (int dj = -1; dj <= 1; ++dj) {
+                int fj = 2*j+dj;
+                if (fj < 0 || fj >= numFineLat) continue;
+                double wj = (dj == 0 ? 1.0 : 0.5)*fineWeight[fj];
+                int fi = 2*i;
+                sum += wj*(0.5*fine((fi-1+numFineLon)%numFineLon, fj)+
+                           fine(fi, fj)+0.5*fine((fi+1)%numFineLon, fj));
+            }
+            coarse(i, j) = sum/coarseWeight[j];
+        }
+    }
+    // The Poles are zonal means.
+    int poles[2] = {0, numLat-1};
+    for (int k = 0; k < 2; ++k) {
+        double mean = 0.0;
+        for (int i = 0; i < numLon; ++i) {
+            mean += coarse(i, poles[k]);
+        }
+        mean /= numLon;
+        for (int i = 0; i < numLon; ++i) {
+            coarse(i, poles[k]) = mean;
+        }
+    }
+} // restrictField
+
+} // barotropic_model
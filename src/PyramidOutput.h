@@ -0,0 +1,79 @@
+#ifndef __PyramidOutput__
+#define __PyramidOutput__
+
+#include "BarotropicModel.h"
+#include <fstream>
+
+namespace barotropic_model {
+
+/**
+ *  This class writes a multi-resolution pyramid of the model state, so that
+ *  the post-processing and visualization can read only the resolution they
+ *  need. Level l has 2^l times coarser grids along both directions, and its
+ *  cell centers are every 2^l-th cell center of the model mesh (including
+ *  the Poles). Each level is averaged from the previous one with the area
+ *  weights of the cells (half of the cells between two coarse centers go to
+ *  each side), so the area integrals of gd, u, v and ghs are kept on every
+ *  level. The Poles are zonal means on every level as on the model mesh.
+ *
+ *  Level l is written into the files "<prefix>.l<l>.%5s.nc" along with the
+ *  full-resolution files, and the time index file "<prefix>.index" lists
+ *  the written frames with their step numbers (the file stamps) and elapsed
+ *  seconds, so the tools can find the frames without listing the files.
+ *
+ *  Note: The pyramid stops at the level whose mesh can not be halved (the
+ *        number of longitudes must be even, and the number of latitudes must
+ *        be odd).
+ */
+class PyramidOutput {
+protected:
+    struct Level {
+        Domain *domain;
+        Mesh *mesh;
+        Field<double> u, v, gd, ghs;
+        vector<double> weight;  //>! area weight of one cell on each row
+        int fileIdx;
+    };
+
+    BarotropicModel *model;
+    IOManager io;
+    vector<double> modelWeight;
+    vector<Level*> levels;
+    string prefix;
+    double interval;            //>! output interval in seconds
+    double stepSize;            //>! time step in seconds
+    std::ofstream index;
+    int numFrame;
+public:
+    PyramidOutput();
+    virtual ~PyramidOutput();
+
+    /**
+     *  Set up the levels (at most numLevel) for the initialized model. The
+     *  frames are written every interval seconds.
+     */
+    void
+    init(BarotropicModel &model, TimeManager &timeManager, int numLevel,
+         double interval, const string &prefix = "output");
+
+    int
+    numLevel() const {
+        return levels.size();
+    }
+
+    /**
+     *  Average the given time level of the model through the levels and
+     *  write them if the elapsed seconds are on the output interval.
+     */
+    void
+    output(const TimeLevelIndex<2> &timeIdx, double elapsedSeconds);
+private:
+    template <class FineView>
+    static void
+    restrictField(const FineView &fine, const vector<double> &fineWeight,
+                  FieldView coarse, const vector<double> &coarseWeight);
+}; // PyramidOutput
+
+} // barotropic_model
+
+#endif // __PyramidOutput__
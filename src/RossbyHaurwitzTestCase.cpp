@@ -1,4 +1,5 @@
 #include "RossbyHaurwitzTestCase.h"
+#include "BoundaryExchange.h"
 
 namespace barotropic_model {
 
@@ -111,10 +112,8 @@ calcInitCond(BarotropicModel &model) {
     assert(gd.min(initTimeIdx) != 0.0);
 #endif
     // -------------------------------------------------------------------------
-    u.applyBndCond(initTimeIdx);
-    v.applyBndCond(initTimeIdx);
-    gd.applyBndCond(initTimeIdx);
-    ghs.applyBndCond();
+    BoundaryExchange::run(initTimeIdx, {&u, &v, &gd});
+    BoundaryExchange::run({&ghs});
 }
 
 }
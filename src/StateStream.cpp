@@ -0,0 +1,199 @@
+#include "StateStream.h"
+#include "MemoryArena.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstring>
+
+namespace barotropic_model {
+
+static const char STREAM_MAGIC[8] = "BTMSTRM";
+static const uint32_t STREAM_VERSION = 1;
+
+StateStream::StateStream() {
+    model = NULL;
+    isProducer = false;
+    region = NULL;
+    regionSize = 0;
+    header = NULL;
+    lastRead = 0;
+    REPORT_ONLINE;
+}
+
+StateStream::~StateStream() {
+    close();
+    REPORT_OFFLINE;
+}
+
+void StateStream::
+create(BarotropicModel &model, const string &name, int decimation,
+       int numSlot) {
+    if (decimation < 1 || numSlot < 2) {
+        REPORT_ERROR("Stream decimation must be positive and slot number " <<
+                     "must be at least 2!");
+    }
+    close();
+    this->model = &model;
+    this->name = name;
+    isProducer = true;
+    const Mesh &mesh = model.mesh();
+    uint32_t numLon = (mesh.numGrid(0, FULL)+decimation-1)/decimation;
+    uint32_t numLat = (mesh.numGrid(1, FULL)+decimation-1)/decimation;
+    uint32_t numField = 3;
+    size_t slotSize = sizeof(SlotHeader)+numField*numLon*numLat*sizeof(float);
+    slotSize = (slotSize+MemoryArena::CACHE_LINE_SIZE-1)/
+        MemoryArena::CACHE_LINE_SIZE*MemoryArena::CACHE_LINE_SIZE;
+    regionSize = sizeof(Header)+numSlot*slotSize;
+    // Create the shared memory object, replacing a stale one.
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT|O_EXCL|O_RDWR, 0644);
+    if (fd < 0) {
+        REPORT_ERROR("Failed to create shared memory \"" << name << "\"!");
+    }
+    if (ftruncate(fd, regionSize) != 0) {
+        ::close(fd);
+        shm_unlink(name.c_str());
+        REPORT_ERROR("Failed to resize shared memory \"" << name << "\"!");
+    }
+    void *ptr = mmap(NULL, regionSize, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (ptr == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        REPORT_ERROR("Failed to map shared memory \"" << name << "\"!");
+    }
+    region = static_cast<char*>(ptr);
+    // Fill the headers, and publish the magic last, so that a consumer never
+    // sees a half-filled header.
+    header = reinterpret_cast<Header*>(region);
+    header->version = STREAM_VERSION;
+    header->numSlot = numSlot;
+    header->slotSize = slotSize;
+    header->numLon = numLon;
+    header->numLat = numLat;
+    header->decimation = decimation;
+    header->numField = numField;
+    header->fieldIds[0] = U;
+    header->fieldIds[1] = V;
+    header->fieldIds[2] = GD;
+    header->numPublished.store(0, std::memory_order_relaxed);
+    for (int s = 0; s < numSlot; ++s) {
+        SlotHeader *slotHeader = slot(s);
+        slotHeader->sequence.store(0, std::memory_order_relaxed);
+        slotHeader->numLon = numLon;
+        slotHeader->numLat = numLat;
+        slotHeader->numField = numField;
+        memcpy(slotHeader->fieldIds, header->fieldIds, sizeof(header->fieldIds));
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(header->magic, STREAM_MAGIC, sizeof(STREAM_MAGIC));
+} // create
+
+void StateStream::
+publish(double elapsedSeconds, uint64_t step) {
+    if (!isProducer) {
+        REPORT_ERROR("Stream is not created by this process!");
+    }
+    uint64_t n = header->numPublished.load(std::memory_order_relaxed);
+    SlotHeader *slotHeader = slot(n);
+    slotHeader->sequence.store(2*n+1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slotHeader->elapsedSeconds = elapsedSeconds;
+    slotHeader->step = step;
+    BarotropicModel::StateView state = model->state();
+    const ConstFieldView *fields[3] = {&state.u, &state.v, &state.gd};
+    int d = header->decimation;
+    int numLon = header->numLon, numLat = header->numLat;
+    float *data = reinterpret_cast<float*>(slotHeader+1);
+    for (int f = 0; f < 3; ++f) {
+        const ConstFieldView &field = *fields[f];
+        float *fieldData = data+f*numLon*numLat;
+        #pragma omp parallel for
+        for (int j = 0; j < numLat; ++j) {
+            for (int i = 0; i < numLon; ++i) {
+                fieldData[j*numLon+i] = field(i*d, j*d);
+            }
+        }
+    }
+    slotHeader->sequence.store(2*n+2, std::memory_order_release);
+    header->numPublished.store(n+1, std::memory_order_release);
+} // publish
+
+void StateStream::
+open(const string &name) {
+    close();
+    this->name = name;
+    isProducer = false;
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        REPORT_ERROR("Failed to open shared memory \"" << name << "\"!");
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < sizeof(Header)) {
+        ::close(fd);
+        REPORT_ERROR("Shared memory \"" << name << "\" is not a stream!");
+    }
+    regionSize = info.st_size;
+    void *ptr = mmap(NULL, regionSize, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (ptr == MAP_FAILED) {
+        REPORT_ERROR("Failed to map shared memory \"" << name << "\"!");
+    }
+    region = static_cast<char*>(ptr);
+    header = reinterpret_cast<Header*>(region);
+    bool isStream = memcmp(header->magic, STREAM_MAGIC, sizeof(STREAM_MAGIC)) == 0;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (!isStream || header->version != STREAM_VERSION ||
+        sizeof(Header)+header->numSlot*header->slotSize > regionSize) {
+        close();
+        REPORT_ERROR("Shared memory \"" << name << "\" is not a stream " <<
+                     "of version " << STREAM_VERSION << "!");
+    }
+    lastRead = 0;
+} // open
+
+bool StateStream::
+readLatest(Snapshot &snapshot) {
+    if (header == NULL) {
+        REPORT_ERROR("Stream is not opened!");
+    }
+    while (true) {
+        uint64_t n = header->numPublished.load(std::memory_order_acquire);
+        if (n == lastRead) return false;
+        const SlotHeader *slotHeader = slot(n-1);
+        uint64_t sequence = slotHeader->sequence.load(std::memory_order_acquire);
+        // The slot is being overwritten by a newer snapshot, so try again.
+        if (sequence != 2*n) continue;
+        snapshot.index = n-1;
+        snapshot.elapsedSeconds = slotHeader->elapsedSeconds;
+        snapshot.step = slotHeader->step;
+        snapshot.numLon = slotHeader->numLon;
+        snapshot.numLat = slotHeader->numLat;
+        snapshot.fieldIds.assign(slotHeader->fieldIds,
+                                 slotHeader->fieldIds+slotHeader->numField);
+        size_t size = size_t(slotHeader->numField)*snapshot.numLon*snapshot.numLat;
+        snapshot.data.resize(size);
+        memcpy(&snapshot.data[0], slotHeader+1, size*sizeof(float));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slotHeader->sequence.load(std::memory_order_relaxed) == sequence) {
+            lastRead = n;
+            return true;
+        }
+    }
+} // readLatest
+
+void StateStream::
+close() {
+    if (region != NULL) {
+        munmap(region, regionSize);
+        if (isProducer) {
+            shm_unlink(name.c_str());
+        }
+    }
+    region = NULL;
+    regionSize = 0;
+    header = NULL;
+    isProducer = false;
+} // close
+
+} // barotropic_model
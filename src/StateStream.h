@@ -0,0 +1,125 @@
+#ifndef __StateStream__
+#define __StateStream__
+
+#include "BarotropicModel.h"
+#include <atomic>
+#include <stdint.h>
+
+namespace barotropic_model {
+
+/**
+ *  This class streams snapshots of the model state through a POSIX shared
+ *  memory ring buffer, so that a visualizer or analysis process on the same
+ *  machine can follow a running model without waiting for the output files.
+ *
+ *  The producer (create() and publish()) owns the shared memory object and
+ *  writes each snapshot into the next slot of the ring without any lock, so
+ *  it never waits for the consumers, and nothing happens when no consumer is
+ *  attached. A consumer (open() and readLatest()) copies the latest slot and
+ *  checks its sequence number before and after the copy, like a seqlock, so a
+ *  snapshot overwritten during the copy is detected and taken again. A slow
+ *  consumer just skips snapshots.
+ *
+ *  The shared memory starts with a Header, followed by numSlot slots. Each
+ *  slot is a SlotHeader followed by the fields as float arrays in the order
+ *  of fieldIds, each of numLon x numLat values with contiguous rows, starting
+ *  from the South Pole. With decimation d, the snapshot takes every d-th cell
+ *  along both directions, starting from the first cell and the South Pole.
+ *  All the integers are in the native byte order.
+ */
+class StateStream {
+public:
+    enum FieldId {
+        U = 0, V = 1, GD = 2
+    };
+
+    static const int MAX_NUM_FIELD = 4;
+
+    struct Header {
+        char magic[8];              //>! "BTMSTRM"
+        uint32_t version;
+        uint32_t numSlot;
+        uint64_t slotSize;          //>! bytes of one slot (with SlotHeader)
+        uint32_t numLon, numLat;    //>! decimated mesh shape
+        uint32_t decimation;
+        uint32_t numField;
+        uint32_t fieldIds[MAX_NUM_FIELD];
+        std::atomic<uint64_t> numPublished;
+    };
+
+    struct SlotHeader {
+        //>! 2n+1 while snapshot n is written, 2n+2 when it is complete
+        std::atomic<uint64_t> sequence;
+        double elapsedSeconds;
+        uint64_t step;
+        uint32_t numLon, numLat;
+        uint32_t numField;
+        uint32_t fieldIds[MAX_NUM_FIELD];
+    };
+
+    struct Snapshot {
+        uint64_t index;             //>! publish count of the snapshot
+        double elapsedSeconds;
+        uint64_t step;
+        int numLon, numLat;
+        vector<int> fieldIds;
+        vector<float> data;
+    };
+protected:
+    BarotropicModel *model;
+    string name;
+    bool isProducer;
+    char *region;
+    size_t regionSize;
+    Header *header;
+    uint64_t lastRead;              //>! publish count of the last read snapshot
+public:
+    StateStream();
+    virtual ~StateStream();
+
+    /**
+     *  Create the shared memory object with the given name (e.g.
+     *  "/barotropic-model") for the initialized model, replacing a stale one
+     *  of the same name.
+     */
+    void
+    create(BarotropicModel &model, const string &name, int decimation = 1,
+           int numSlot = 4);
+
+    /**
+     *  Write the current time level of the model into the next slot.
+     */
+    void
+    publish(double elapsedSeconds, uint64_t step);
+
+    /**
+     *  Attach to the shared memory object of a running producer.
+     */
+    void
+    open(const string &name);
+
+    /**
+     *  Copy the latest snapshot if it is newer than the last one read, and
+     *  return whether one is copied.
+     */
+    bool
+    readLatest(Snapshot &snapshot);
+
+    void
+    close();
+
+    const Header&
+    streamHeader() const {
+        return *header;
+    }
+private:
+    SlotHeader*
+    slot(uint64_t index) const {
+        return reinterpret_cast<SlotHeader*>(region+sizeof(Header)+
+                                             (index%header->numSlot)*header->slotSize);
+    }
+}; // StateStream
+
+} // barotropic_model
+
+#endif // __StateStream__
@@ -0,0 +1,214 @@
+#include "StationOutput.h"
+#include <sstream>
+
+namespace barotropic_model {
+
+StationOutput::StationOutput() {
+    model = NULL;
+    REPORT_ONLINE;
+}
+
+StationOutput::~StationOutput() {
+    if (file.is_open()) {
+        file.close();
+    }
+    REPORT_OFFLINE;
+}
+
+void StationOutput::
+init(BarotropicModel &model, const string &locationFileName,
+     const string &outputFileName) {
+    this->model = &model;
+    points.clear();
+    readLocations(locationFileName);
+    if (points.size() == 0) {
+        REPORT_ERROR("No station or transect in \"" << locationFileName << "\"!");
+    }
+    // Compute the interpolation weights.
+    weightStart.assign(1, 0);
+    weightLon.clear();
+    weightLat.clear();
+    weight.clear();
+    for (int p = 0; p < points.size(); ++p) {
+        calcWeights(points[p]);
+        weightStart.push_back(weight.size());
+    }
+    record.resize(3*points.size());
+    // Write the header.
+    file.open(outputFileName.c_str(), std::ios::binary);
+    if (!file) {
+        REPORT_ERROR("Failed to open \"" << outputFileName << "\"!");
+    }
+    const Mesh &mesh = model.mesh();
+    file << "# barotropic-model station output" << endl;
+    file << "# mesh " << mesh.numGrid(0, FULL) << "x" << mesh.numGrid(1, FULL) << endl;
+    file << "# points " << points.size() << endl;
+    file << "# variables u v gd" << endl;
+    for (int p = 0; p < points.size(); ++p) {
+        file << "# " << setw(6) << p << " " << setw(20) << std::left <<
+            points[p].name << std::right << fixed << setprecision(4) <<
+            setw(10) << points[p].lon/RAD << setw(10) << points[p].lat/RAD <<
+            setprecision(1) << setw(10) << points[p].distance*1.0e-3 << endl;
+    }
+    file << "# end" << endl;
+} // init
+
+void StationOutput::
+output(double elapsedSeconds) {
+    BarotropicModel::StateView state = model->state();
+    int n = points.size();
+    #pragma omp parallel for
+    for (int p = 0; p < n; ++p) {
+        double u = 0.0, v = 0.0, gd = 0.0;
+        for (int k = weightStart[p]; k < weightStart[p+1]; ++k) {
+            int i = weightLon[k], j = weightLat[k];
+            u += weight[k]*state.u(i, j);
+            v += weight[k]*state.v(i, j);
+            gd += weight[k]*state.gd(i, j);
+        }
+        record[p] = u;
+        record[n+p] = v;
+        record[2*n+p] = gd;
+    }
+    file.write(reinterpret_cast<const char*>(&elapsedSeconds), sizeof(double));
+    file.write(reinterpret_cast<const char*>(&record[0]), record.size()*sizeof(float));
+    file.flush();
+} // output
+
+void StationOutput::
+readLocations(const string &fileName) {
+    std::ifstream locationFile(fileName.c_str());
+    if (!locationFile) {
+        REPORT_ERROR("Failed to open locations \"" << fileName << "\"!");
+    }
+    string line;
+    int lineNo = 0;
+    while (std::getline(locationFile, line)) {
+        ++lineNo;
+        line = line.substr(0, line.find('#'));
+        std::istringstream ss(line);
+        string kind, name;
+        if (!(ss >> kind)) continue;
+        if (kind == "station") {
+            double lon, lat;
+            if (!(ss >> name >> lon >> lat)) {
+                REPORT_ERROR("Line " << lineNo << " of \"" << fileName << "\" " <<
+                             "should be \"station <name> <lon> <lat>\"!");
+            }
+            Point point;
+            point.name = name;
+            point.lon = lon*RAD;
+            point.lat = lat*RAD;
+            point.distance = 0;
+            points.push_back(point);
+        } else if (kind == "transect") {
+            double lon0, lat0, lon1, lat1, spacing;
+            if (!(ss >> name >> lon0 >> lat0 >> lon1 >> lat1 >> spacing) ||
+                spacing <= 0) {
+                REPORT_ERROR("Line " << lineNo << " of \"" << fileName << "\" " <<
+                             "should be \"transect <name> <lon1> <lat1> " <<
+                             "<lon2> <lat2> <spacing>\" with positive spacing!");
+            }
+            SpaceCoord x0(2), x1(2);
+            x0.set(lon0*RAD, lat0*RAD);
+            x1.set(lon1*RAD, lat1*RAD);
+            addTransect(name, x0, x1, spacing*1.0e3);
+        } else {
+            REPORT_ERROR("Unknown location kind \"" << kind << "\" on line " <<
+                         lineNo << " of \"" << fileName << "\"!");
+        }
+    }
+} // readLocations
+
+void StationOutput::
+addTransect(const string &name, const SpaceCoord &x0, const SpaceCoord &x1,
+            double spacing) {
+    const Domain &domain = model->domain();
+    double length = domain.calcDistance(x0, x1);
+    double angle = length/domain.radius();
+    if (fabs(sin(angle)) < 1.0e-12 && length > 0) {
+        REPORT_ERROR("Transect \"" << name << "\" has antipodal end points, " <<
+                     "so its great circle is not unique!");
+    }
+    int numArc = std::max(1, int(ceil(length/spacing)));
+    // Interpolate spherically between the unit vectors of the end points.
+    double p0[3] = {
+        cos(x0(1))*cos(x0(0)), cos(x0(1))*sin(x0(0)), sin(x0(1))
+    };
+    double p1[3] = {
+        cos(x1(1))*cos(x1(0)), cos(x1(1))*sin(x1(0)), sin(x1(1))
+    };
+    for (int k = 0; k <= numArc; ++k) {
+        double t = double(k)/numArc;
+        double a, b;
+        if (angle == 0) {
+            a = 1; b = 0;
+        } else {
+            a = sin((1-t)*angle)/sin(angle);
+            b = sin(t*angle)/sin(angle);
+        }
+        double x = a*p0[0]+b*p1[0];
+        double y = a*p0[1]+b*p1[1];
+        double z = a*p0[2]+b*p1[2];
+        std::ostringstream pointName;
+        pointName << name << "." << k;
+        Point point;
+        point.name = pointName.str();
+        point.lon = atan2(y, x);
+        point.lat = atan2(z, sqrt(x*x+y*y));
+        point.distance = domain.calcDistance(x0, point.lon, sin(point.lat),
+                                             cos(point.lat));
+        points.push_back(point);
+    }
+} // addTransect
+
+void StationOutput::
+calcWeights(const Point &point) {
+    const Mesh &mesh = model->mesh();
+    int numLon = mesh.numGrid(0, FULL);
+    int numLat = mesh.numGrid(1, FULL);
+    if (point.lat < mesh.gridCoordComp(1, FULL, mesh.js(FULL))-1.0e-12 ||
+        point.lat > mesh.gridCoordComp(1, FULL, mesh.je(FULL))+1.0e-12) {
+        REPORT_ERROR("Point \"" << point.name << "\" is outside the mesh!");
+    }
+    // Find the surrounding rows.
+    int js = mesh.js(FULL), j0 = 0;
+    while (j0 < numLat-2 && mesh.gridCoordComp(1, FULL, js+j0+1) <= point.lat) {
+        ++j0;
+    }
+    double lat0 = mesh.gridCoordComp(1, FULL, js+j0);
+    double lat1 = mesh.gridCoordComp(1, FULL, js+j0+1);
+    double b = std::min(1.0, std::max(0.0, (point.lat-lat0)/(lat1-lat0)));
+    // Find the surrounding columns.
+    double lon0 = mesh.gridCoordComp(0, FULL, mesh.is(FULL));
+    double dlon = mesh.gridInterval(0, FULL, mesh.is(FULL));
+    double x = fmod(point.lon-lon0, PI2);
+    if (x < 0) x += PI2;
+    x /= dlon;
+    int i0 = int(floor(x))%numLon;
+    int i1 = (i0+1)%numLon;
+    double a = x-floor(x);
+    // Add the weights of the two rows. The pole rows enter as zonal means.
+    int rows[2] = {j0, j0+1};
+    double rowWeights[2] = {1-b, b};
+    for (int r = 0; r < 2; ++r) {
+        int j = rows[r];
+        if (rowWeights[r] == 0) continue;
+        if (j == 0 || j == numLat-1) {
+            for (int i = 0; i < numLon; ++i) {
+                weightLon.push_back(i);
+                weightLat.push_back(j);
+                weight.push_back(rowWeights[r]/numLon);
+            }
+        } else {
+            weightLon.push_back(i0);
+            weightLat.push_back(j);
+            weight.push_back(rowWeights[r]*(1-a));
+            weightLon.push_back(i1);
+            weightLat.push_back(j);
+            weight.push_back(rowWeights[r]*a);
+        }
+    }
+} // calcWeights
+
+} // barotropic_model
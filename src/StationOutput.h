@@ -0,0 +1,88 @@
+#ifndef __StationOutput__
+#define __StationOutput__
+
+#include "BarotropicModel.h"
+#include <fstream>
+
+namespace barotropic_model {
+
+/**
+ *  This class samples u, v and gd at a set of stations and along great-circle
+ *  transects every step, and streams them into one compact file, for the
+ *  users who only need time series at some locations instead of the full
+ *  fields.
+ *
+ *  The locations are read from a text file, one per line (text after "#" is
+ *  ignored, longitudes and latitudes are in degrees):
+ *
+ *      station  <name> <lon> <lat>
+ *      transect <name> <lon1> <lat1> <lon2> <lat2> <spacing in km>
+ *
+ *  A transect is cut into equal arcs no longer than the spacing, and its
+ *  points are named "<name>.<k>". The interpolation weights are computed
+ *  once in init(): bilinear in longitude and latitude between the four
+ *  surrounding cell centers, except that a pole row enters as its zonal mean
+ *  (with the weight spread over all its cells), so the points near the Poles
+ *  do not depend on the longitudes of the pole cells. The weights of all the
+ *  points are kept in one compressed-row table, and output() gathers the
+ *  three variables of all the points in a single pass over it.
+ *
+ *  The file starts with a text header, which lists the points (index, name,
+ *  longitude, latitude and distance along the transect in km) and ends with
+ *  the line "# end". Then each sampled step is one binary record of the
+ *  elapsed seconds (double) followed by u, v and gd of all the points
+ *  (float, in the order of the points), in the native byte order.
+ */
+class StationOutput {
+protected:
+    struct Point {
+        string name;
+        double lon, lat;    //>! in radians
+        double distance;    //>! distance along the transect in meters
+    };
+
+    BarotropicModel *model;
+    vector<Point> points;
+    vector<int> weightStart;    //>! start of the weights of each point
+    vector<int> weightLon;
+    vector<int> weightLat;
+    vector<double> weight;
+    vector<float> record;
+    std::ofstream file;
+public:
+    StationOutput();
+    virtual ~StationOutput();
+
+    /**
+     *  Read the locations, compute the interpolation weights for the mesh of
+     *  the initialized model, and write the header of the output file.
+     */
+    void
+    init(BarotropicModel &model, const string &locationFileName,
+         const string &outputFileName = "output.stations");
+
+    int
+    numPoint() const {
+        return points.size();
+    }
+
+    /**
+     *  Sample the current time level of the model and append it to the file.
+     */
+    void
+    output(double elapsedSeconds);
+private:
+    void
+    readLocations(const string &fileName);
+
+    void
+    addTransect(const string &name, const SpaceCoord &x0,
+                const SpaceCoord &x1, double spacing);
+
+    void
+    calcWeights(const Point &point);
+}; // StationOutput
+
+} // barotropic_model
+
+#endif // __StationOutput__
@@ -0,0 +1,237 @@
+#include "SweepRunner.h"
+#include "ThreadPool.h"
+#include "BarotropicModel_A_SemiImplicit.h"
+#include "RossbyHaurwitzTestCase.h"
+#include "ToyTestCase.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+namespace barotropic_model {
+
+// Split the string by the given delimiter.
+static vector<string>
+split(const string &str, char delim) {
+    vector<string> res;
+    std::istringstream ss(str);
+    string item;
+    while (std::getline(ss, item, delim)) {
+        res.push_back(item);
+    }
+    return res;
+}
+
+SweepRunner::SweepRunner() {
+    REPORT_ONLINE;
+}
+
+SweepRunner::~SweepRunner() {
+    std::map<std::pair<int, int>, std::pair<Domain*, Mesh*> >::iterator it;
+    for (it = meshes.begin(); it != meshes.end(); ++it) {
+        delete it->second.second;
+        delete it->second.first;
+    }
+    REPORT_OFFLINE;
+}
+
+void SweepRunner::
+readMatrix(const string &fileName) {
+    std::ifstream file(fileName.c_str());
+    if (!file) {
+        REPORT_ERROR("Failed to open run matrix \"" << fileName << "\"!");
+    }
+    string line;
+    int lineNo = 0;
+    while (std::getline(file, line)) {
+        ++lineNo;
+        line = line.substr(0, line.find('#'));
+        std::istringstream ss(line);
+        vector<string> columns;
+        string column;
+        while (ss >> column) {
+            columns.push_back(column);
+        }
+        if (columns.size() == 0) continue;
+        if (columns.size() != 6) {
+            REPORT_ERROR("Line " << lineNo << " of \"" << fileName << "\" " <<
+                         "should have 6 columns!");
+        }
+        // Expand the lists into the cartesian product.
+        vector<vector<string> > lists(6);
+        for (int i = 0; i < 6; ++i) {
+            lists[i] = i == 0 ? vector<string>(1, columns[i]) : split(columns[i], ',');
+        }
+        vector<int> idx(6, 0);
+        while (true) {
+            string name = columns[0];
+            for (int i = 1; i < 6; ++i) {
+                if (lists[i].size() > 1) name += "-"+lists[i][idx[i]];
+            }
+            vector<string> res = split(lists[2][idx[2]], 'x');
+            if (res.size() != 2) {
+                REPORT_ERROR("Invalid resolution \"" << lists[2][idx[2]] <<
+                             "\" on line " << lineNo << "!");
+            }
+            addRun(name, lists[1][idx[1]], lists[5][idx[5]],
+                   atoi(res[0].c_str()), atoi(res[1].c_str()),
+                   atof(lists[3][idx[3]].c_str()), atof(lists[4][idx[4]].c_str()));
+            int i;
+            for (i = 5; i > 0; --i) {
+                if (++idx[i] < lists[i].size()) break;
+                idx[i] = 0;
+            }
+            if (i == 0) break;
+        }
+    }
+} // readMatrix
+
+void SweepRunner::
+addRun(const string &name, const string &testCase, const string &variant,
+       int numLon, int numLat, double dt, double days) {
+    if (testCase != "rossby-haurwitz" && testCase != "toy") {
+        REPORT_ERROR("Unknown test case \"" << testCase << "\"!");
+    }
+    if (variant != "full" && variant != "lean" && variant != "reduced" &&
+        variant != "lean-reduced" && variant != "semi-implicit") {
+        REPORT_ERROR("Unknown variant \"" << variant << "\"!");
+    }
+    if (numLon <= 0 || numLat <= 0 || dt <= 0 || days <= 0) {
+        REPORT_ERROR("Invalid run \"" << name << "\"!");
+    }
+    // The time manager steps by whole seconds.
+    if (dt != int(dt)) {
+        REPORT_ERROR("Time step of run \"" << name << "\" should be whole " <<
+                     "seconds!");
+    }
+    Run run;
+    run.name = name;
+    run.testCase = testCase;
+    run.variant = variant;
+    run.numLon = numLon;
+    run.numLat = numLat;
+    run.dt = dt;
+    run.days = days;
+    run.numStep = 0;
+    run.status = "pending";
+    run.energyDrift = 0;
+    run.massDrift = 0;
+    run.wallTime = 0;
+    runs.push_back(run);
+} // addRun
+
+void SweepRunner::
+run(int numThread) {
+    // Start the runs in the order of decreasing cost (grid points x steps).
+    vector<int> order(runs.size());
+    for (int i = 0; i < runs.size(); ++i) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [this] (int a, int b) {
+        return double(runs[a].numLon)*runs[a].numLat*runs[a].days/runs[a].dt >
+               double(runs[b].numLon)*runs[b].numLat*runs[b].days/runs[b].dt;
+    });
+    ThreadPool pool(numThread);
+    cout << "[Notice]: Run " << runs.size() << " entries on " <<
+        pool.numThread() << " threads." << endl;
+    // Note: The pool takes the latest task of its own queue first, so the
+    //       tasks are submitted in the reversed order.
+    for (int k = order.size()-1; k >= 0; --k) {
+        Run &run = runs[order[k]];
+        pool.submit([this, &run] () { runOne(run); });
+    }
+    pool.wait();
+} // run
+
+std::pair<Domain*, Mesh*> SweepRunner::
+getMesh(int numLon, int numLat) {
+    std::lock_guard<std::mutex> lock(meshMutex);
+    std::pair<Domain*, Mesh*> &entry = meshes[std::make_pair(numLon, numLat)];
+    if (entry.second == NULL) {
+        entry.first = new Domain(2);
+        entry.first->radius() = 6.371e6;
+        entry.second = new Mesh(*entry.first);
+        entry.second->init(numLon, numLat);
+    }
+    return entry;
+} // getMesh
+
+void SweepRunner::
+runOne(Run &run) {
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point t0 = Clock::now();
+    std::pair<Domain*, Mesh*> mesh = getMesh(run.numLon, run.numLat);
+    BarotropicModel_A_ImplicitMidpoint *model;
+    if (run.variant == "semi-implicit") {
+        model = new BarotropicModel_A_SemiImplicit;
+    } else {
+        model = new BarotropicModel_A_ImplicitMidpoint;
+    }
+    TimeManager timeManager;
+    ptime startTime(date(2000, 1, 1));
+    timeManager.init(startTime, startTime+seconds(int(run.days*86400)),
+                     seconds(int(run.dt)));
+    model->setLeanMemory(run.variant == "lean" || run.variant == "lean-reduced");
+    model->setReducedGrid(run.variant == "reduced" || run.variant == "lean-reduced");
+    model->setSharedMesh(*mesh.first, *mesh.second);
+    model->setVerbose(false);
+    model->init(timeManager, run.numLon, run.numLat);
+    if (run.testCase == "rossby-haurwitz") {
+        RossbyHaurwitzTestCase testCase;
+        testCase.calcInitCond(*model);
+    } else {
+        ToyTestCase testCase;
+        testCase.calcInitCond(*model);
+    }
+    model->initialize();
+    double e0 = model->totalEnergy();
+    double m0 = model->totalMass();
+    int numStep = run.days*86400/run.dt;
+    int numDayStep = std::max(1, int(86400/run.dt));
+    run.status = "done";
+    while (run.numStep < numStep) {
+        int n = std::min(numDayStep, numStep-run.numStep);
+        model->step(n);
+        run.numStep += n;
+        run.energyDrift = (model->totalEnergy()-e0)/e0;
+        run.massDrift = (model->totalMass()-m0)/m0;
+        if (!std::isfinite(run.energyDrift) || fabs(run.energyDrift) > 0.01) {
+            run.status = "unstable";
+            break;
+        }
+    }
+    delete model;
+    run.wallTime = std::chrono::duration<double>(Clock::now()-t0).count();
+} // runOne
+
+void SweepRunner::
+writeSummary(std::ostream &os) const {
+    os << std::left << setw(32) << "name" << setw(16) << "test-case" <<
+        setw(10) << "res" << setw(8) << "dt" << setw(8) << "days" <<
+        setw(14) << "variant" << setw(10) << "status" << std::right <<
+        setw(8) << "steps" << setw(14) << "energy-drift" <<
+        setw(14) << "mass-drift" << setw(10) << "wall(s)" <<
+        setw(10) << "steps/s" << endl;
+    for (int i = 0; i < runs.size(); ++i) {
+        const Run &run = runs[i];
+        std::ostringstream res;
+        res << run.numLon << "x" << run.numLat;
+        os << std::left << setw(32) << run.name << setw(16) << run.testCase <<
+            setw(10) << res.str() << setw(8) << run.dt << setw(8) << run.days <<
+            setw(14) << run.variant << setw(10) << run.status << std::right <<
+            setw(8) << run.numStep << std::scientific << setprecision(3) <<
+            setw(14) << run.energyDrift << setw(14) << run.massDrift <<
+            fixed << setprecision(2) << setw(10) << run.wallTime <<
+            setw(10) << (run.wallTime > 0 ? run.numStep/run.wallTime : 0) <<
+            std::defaultfloat << setprecision(6) << endl;
+    }
+} // writeSummary
+
+void SweepRunner::
+writeSummary(const string &fileName) const {
+    std::ofstream file(fileName.c_str());
+    if (!file) {
+        REPORT_ERROR("Failed to open summary file \"" << fileName << "\"!");
+    }
+    writeSummary(file);
+} // writeSummary
+
+} // barotropic_model
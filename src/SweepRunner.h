@@ -0,0 +1,100 @@
+#ifndef __SweepRunner__
+#define __SweepRunner__
+
+#include "BarotropicModel_A_ImplicitMidpoint.h"
+#include <map>
+#include <mutex>
+
+namespace barotropic_model {
+
+/**
+ *  This class runs a matrix of model configurations (test case, resolution,
+ *  time step and integrator variant) concurrently on a work-stealing thread
+ *  pool, and summarizes the conservation and cost of each run.
+ *
+ *  The matrix file has one line per entry with the whitespace-separated
+ *  columns
+ *
+ *      name  test-case  resolution  dt  days  variant
+ *
+ *  where the resolution is given as <numLon>x<numLat>, the time step in
+ *  whole seconds, and the variant is one of "full", "lean", "reduced",
+ *  "lean-reduced" (the implicit midpoint model) and "semi-implicit" (see
+ *  BarotropicModel_A_SemiImplicit). Any column except the name can be a
+ *  comma-separated list, and the entry is expanded into the cartesian
+ *  product of the lists, with the list values appended to the name. Text
+ *  after '#' is ignored.
+ *
+ *  The runs of the same resolution share one mesh. The runs are started in
+ *  the order of decreasing estimated cost, so that the long runs do not end
+ *  up last on a busy pool. A run is marked unstable and stopped when its
+ *  total energy becomes non-finite or drifts by more than 1% (checked after
+ *  each simulated day).
+ */
+class SweepRunner {
+public:
+    struct Run {
+        string name;
+        string testCase;
+        string variant;
+        int numLon, numLat;
+        double dt;          //>! time step in whole seconds
+        double days;        //>! integration length in days
+        // Results.
+        int numStep;
+        string status;      //>! "pending", "done" or "unstable"
+        double energyDrift; //>! relative change of the total energy from the
+                            //>! initial condition (before grid reduction)
+        double massDrift;   //>! relative change of the total mass
+        double wallTime;    //>! seconds
+    };
+protected:
+    vector<Run> runs;
+    std::map<std::pair<int, int>, std::pair<Domain*, Mesh*> > meshes;
+    std::mutex meshMutex;
+public:
+    SweepRunner();
+    virtual ~SweepRunner();
+
+    /**
+     *  Read the run matrix and append its entries.
+     */
+    void
+    readMatrix(const string &fileName);
+
+    void
+    addRun(const string &name, const string &testCase, const string &variant,
+           int numLon, int numLat, double dt, double days);
+
+    const vector<Run>&
+    getRuns() const {
+        return runs;
+    }
+
+    /**
+     *  Run all the entries on the given number of threads (the hardware
+     *  concurrency by default).
+     */
+    void
+    run(int numThread = 0);
+
+    void
+    writeSummary(std::ostream &os) const;
+
+    void
+    writeSummary(const string &fileName) const;
+private:
+    /**
+     *  Return the shared domain and mesh of the given resolution, which are
+     *  created by the first caller.
+     */
+    std::pair<Domain*, Mesh*>
+    getMesh(int numLon, int numLat);
+
+    void
+    runOne(Run &run);
+}; // SweepRunner
+
+} // barotropic_model
+
+#endif // __SweepRunner__
@@ -0,0 +1,96 @@
+#include "TaskGraph.h"
+#include <algorithm>
+
+namespace barotropic_model {
+
+TaskGraph::TaskGraph() {
+    _numEdge = 0;
+}
+
+TaskGraph::~TaskGraph() {
+}
+
+int TaskGraph::
+addTask(const Task &task, const vector<Access> &reads,
+        const vector<Access> &writes) {
+    int nodeIdx = nodes.size();
+    nodes.push_back(Node());
+    nodes.back().task = task;
+    nodes.back().numPredecessor = 0;
+    // Read after write.
+    for (int k = 0; k < reads.size(); ++k) {
+        for (int b = reads[k].bandStart; b <= reads[k].bandEnd; ++b) {
+            BandState &state = bandStates[std::make_pair(reads[k].resource, b)];
+            if (state.lastWriter >= 0) {
+                addEdge(state.lastWriter, nodeIdx);
+            }
+            state.readers.push_back(nodeIdx);
+        }
+    }
+    // Write after read and write after write.
+    for (int k = 0; k < writes.size(); ++k) {
+        for (int b = writes[k].bandStart; b <= writes[k].bandEnd; ++b) {
+            BandState &state = bandStates[std::make_pair(writes[k].resource, b)];
+            for (int r = 0; r < state.readers.size(); ++r) {
+                addEdge(state.readers[r], nodeIdx);
+            }
+            // The readers are ordered after the last writer already.
+            if (state.readers.empty() && state.lastWriter >= 0) {
+                addEdge(state.lastWriter, nodeIdx);
+            }
+            state.lastWriter = nodeIdx;
+            state.readers.clear();
+        }
+    }
+    return nodeIdx;
+} // addTask
+
+void TaskGraph::
+addEdge(int from, int to) {
+    // The same pair may come from several bands or from both reading and
+    // writing one band.
+    if (from == to) return;
+    vector<int> &successors = nodes[from].successors;
+    if (std::find(successors.begin(), successors.end(), to) != successors.end()) {
+        return;
+    }
+    successors.push_back(to);
+    ++nodes[to].numPredecessor;
+    ++_numEdge;
+} // addEdge
+
+void TaskGraph::
+run(ThreadPool &pool) {
+    numWaiting.reset(new std::atomic<int>[nodes.size()]);
+    for (int i = 0; i < nodes.size(); ++i) {
+        numWaiting[i] = nodes[i].numPredecessor;
+    }
+    for (int i = 0; i < nodes.size(); ++i) {
+        if (nodes[i].numPredecessor == 0) {
+            pool.submit([this, &pool, i] () { runNode(pool, i); });
+        }
+    }
+    pool.wait();
+} // run
+
+void TaskGraph::
+runNode(ThreadPool &pool, int nodeIdx) {
+    nodes[nodeIdx].task();
+    const vector<int> &successors = nodes[nodeIdx].successors;
+    for (int k = 0; k < successors.size(); ++k) {
+        int next = successors[k];
+        if (--numWaiting[next] == 0) {
+            pool.submit([this, &pool, next] () { runNode(pool, next); });
+        }
+    }
+} // runNode
+
+void TaskGraph::
+clear() {
+    nodes.clear();
+    bandStates.clear();
+    numWaiting.reset();
+    _numEdge = 0;
+} // clear
+
+} // barotropic_model
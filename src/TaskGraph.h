@@ -0,0 +1,92 @@
+#ifndef __TaskGraph__
+#define __TaskGraph__
+
+#include "ThreadPool.h"
+#include <map>
+#include <memory>
+
+namespace barotropic_model {
+
+/**
+ *  This class is a graph of tasks with the dependencies derived from the data
+ *  they access, which runs on a work-stealing thread pool without barriers.
+ *  Each task declares the bands (e.g. blocks of latitude rows) of the
+ *  resources (e.g. fields) it reads and writes, and is ordered after the
+ *  earlier tasks that write what it reads (read after write), and after the
+ *  earlier tasks that read or write what it writes (write after read, write
+ *  after write), in the order the tasks are added. So the result is the same
+ *  as running the tasks one by one in that order, while the independent
+ *  tasks run concurrently.
+ *
+ *  The graph is built once and can be run many times. A task is submitted to
+ *  the pool as soon as its last predecessor finishes, on the same worker, so
+ *  the consumers of a band tend to run where the band is still in cache.
+ */
+class TaskGraph {
+public:
+    typedef std::function<void ()> Task;
+
+    /**
+     *  The bands [bandStart, bandEnd] of one resource.
+     */
+    struct Access {
+        int resource;
+        int bandStart, bandEnd;
+    };
+private:
+    struct Node {
+        Task task;
+        vector<int> successors;
+        int numPredecessor;
+    };
+
+    struct BandState {
+        int lastWriter;         //>! -1 if none
+        vector<int> readers;    //>! readers since the last writer
+        BandState() : lastWriter(-1) {}
+    };
+
+    vector<Node> nodes;
+    std::map<std::pair<int, int>, BandState> bandStates;
+    std::unique_ptr<std::atomic<int>[]> numWaiting;
+    int _numEdge;
+public:
+    TaskGraph();
+    virtual ~TaskGraph();
+
+    /**
+     *  Add a task after all the tasks added before, and return its index.
+     */
+    int
+    addTask(const Task &task, const vector<Access> &reads,
+            const vector<Access> &writes);
+
+    int
+    numTask() const {
+        return nodes.size();
+    }
+
+    int
+    numEdge() const {
+        return _numEdge;
+    }
+
+    /**
+     *  Run all the tasks on the pool, and return when they are done.
+     */
+    void
+    run(ThreadPool &pool);
+
+    void
+    clear();
+private:
+    void
+    addEdge(int from, int to);
+
+    void
+    runNode(ThreadPool &pool, int nodeIdx);
+}; // TaskGraph
+
+} // barotropic_model
+
+#endif // __TaskGraph__
@@ -0,0 +1,121 @@
+#include "ThreadPool.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace barotropic_model {
+
+// The pool and index of the worker that runs the calling thread (none and
+// -1 for others). A task of one pool may submit to another pool, where its
+// thread is not a worker.
+static thread_local const ThreadPool *currPool = NULL;
+static thread_local int currWorkerIdx = -1;
+
+ThreadPool::ThreadPool(int numThread) {
+    if (numThread <= 0) {
+        numThread = std::max(1u, std::thread::hardware_concurrency());
+    }
+    numQueuedTask = 0;
+    numPendingTask = 0;
+    nextWorker = 0;
+    isStopped = false;
+    for (int i = 0; i < numThread; ++i) {
+        workers.push_back(new Worker);
+    }
+    for (int i = 0; i < numThread; ++i) {
+        threads.push_back(std::thread(&ThreadPool::work, this, i));
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(idleMutex);
+        isStopped = true;
+    }
+    idleCondition.notify_all();
+    for (int i = 0; i < threads.size(); ++i) {
+        threads[i].join();
+    }
+    for (int i = 0; i < workers.size(); ++i) {
+        delete workers[i];
+    }
+}
+
+void ThreadPool::
+submit(const Task &task) {
+    int workerIdx = currPool == this ? currWorkerIdx : -1;
+    if (workerIdx < 0) {
+        workerIdx = nextWorker++%workers.size();
+    }
+    ++numPendingTask;
+    {
+        std::lock_guard<std::mutex> lock(workers[workerIdx]->mutex);
+        workers[workerIdx]->tasks.push_back(task);
+    }
+    ++numQueuedTask;
+    // Note: Take the idle lock, so that the notification can not be lost
+    //       between the check and the wait of an idle worker.
+    std::lock_guard<std::mutex> lock(idleMutex);
+    idleCondition.notify_all();
+} // submit
+
+void ThreadPool::
+wait() {
+    std::unique_lock<std::mutex> lock(idleMutex);
+    doneCondition.wait(lock, [this] () { return numPendingTask == 0; });
+} // wait
+
+bool ThreadPool::
+takeTask(int workerIdx, Task &task) {
+    // Take the latest task of its own.
+    {
+        Worker &worker = *workers[workerIdx];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (!worker.tasks.empty()) {
+            task = worker.tasks.back();
+            worker.tasks.pop_back();
+            --numQueuedTask;
+            return true;
+        }
+    }
+    // Steal the oldest task of the others.
+    for (int i = 1; i < workers.size(); ++i) {
+        Worker &victim = *workers[(workerIdx+i)%workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            --numQueuedTask;
+            return true;
+        }
+    }
+    return false;
+} // takeTask
+
+void ThreadPool::
+work(int workerIdx) {
+    currPool = this;
+    currWorkerIdx = workerIdx;
+#ifdef _OPENMP
+    omp_set_num_threads(1);
+#endif
+    Task task;
+    while (true) {
+        if (takeTask(workerIdx, task)) {
+            task();
+            task = Task();
+            std::lock_guard<std::mutex> lock(idleMutex);
+            if (--numPendingTask == 0) {
+                doneCondition.notify_all();
+            }
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(idleMutex);
+        idleCondition.wait(lock, [this] () {
+            return isStopped || numQueuedTask > 0;
+        });
+        if (isStopped) break;
+    }
+} // work
+
+} // barotropic_model
@@ -0,0 +1,74 @@
+#ifndef __ThreadPool__
+#define __ThreadPool__
+
+#include "barotropic_model_commons.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace barotropic_model {
+
+/**
+ *  This class is a work-stealing thread pool. Each worker owns a task queue,
+ *  takes its own tasks from the back (the latest first), and steals from the
+ *  front of the other queues when its own queue is empty, so that the long
+ *  and short tasks are balanced over the workers without a central queue.
+ *
+ *  Note: The workers run with one OpenMP thread each, since the parallelism
+ *        comes from the concurrent tasks.
+ */
+class ThreadPool {
+public:
+    typedef std::function<void ()> Task;
+private:
+    struct Worker {
+        std::deque<Task> tasks;
+        std::mutex mutex;
+    };
+
+    vector<Worker*> workers;
+    vector<std::thread> threads;
+    std::atomic<int> numQueuedTask;     //>! tasks waiting in the queues
+    std::atomic<int> numPendingTask;    //>! tasks queued or running
+    std::atomic<int> nextWorker;
+    std::mutex idleMutex;
+    std::condition_variable idleCondition;  //>! for new tasks or stop
+    std::condition_variable doneCondition;  //>! for all tasks done
+    bool isStopped;
+public:
+    ThreadPool(int numThread = 0);
+    ~ThreadPool();
+
+    int
+    numThread() const {
+        return threads.size();
+    }
+
+    /**
+     *  Add a task. It is queued on the calling worker when called from a
+     *  task of this pool, or on the workers in turn otherwise (e.g. from a
+     *  task of another pool).
+     */
+    void
+    submit(const Task &task);
+
+    /**
+     *  Wait for all the submitted tasks (including those submitted by the
+     *  tasks) to finish.
+     */
+    void
+    wait();
+private:
+    void
+    work(int workerIdx);
+
+    bool
+    takeTask(int workerIdx, Task &task);
+}; // ThreadPool
+
+} // barotropic_model
+
+#endif // __ThreadPool__
@@ -1,5 +1,6 @@
 #include "ToyTestCase.h"
 #include "GeostrophicRelation.h"
+#include "BoundaryExchange.h"
 
 namespace barotropic_model {
 
@@ -89,8 +90,8 @@ void ToyTestCase::calcInitCond(BarotropicModel &model) {
             }
         }
     }
-    gd.applyBndCond(initTimeIdx);
-    ghs.applyBndCond();
+    BoundaryExchange::run(initTimeIdx, {&gd});
+    BoundaryExchange::run({&ghs});
 #define TOYTESTCASE_GEOSTROPHIC_WIND
 #ifdef TOYTESTCASE_GEOSTROPHIC_WIND
     // Construct initial wind flow from geostropic relation.
@@ -109,8 +110,7 @@ void ToyTestCase::calcInitCond(BarotropicModel &model) {
             v(initTimeIdx, i, j) = 0;
         }
     }
-    u.applyBndCond(initTimeIdx);
-    v.applyBndCond(initTimeIdx);
+    BoundaryExchange::run(initTimeIdx, {&u, &v});
 #endif
 }
 
@@ -0,0 +1,87 @@
+#include "ZonalFFT.h"
+
+namespace barotropic_model {
+
+void ZonalFFT::
+init(int n) {
+    if (n < 1) {
+        REPORT_ERROR("FFT length must be positive!");
+    }
+    this->n = n;
+    factors.clear();
+    int m = n;
+    for (int p = 2; p*p <= m; ++p) {
+        while (m%p == 0) {
+            factors.push_back(p);
+            m /= p;
+        }
+    }
+    if (m > 1 || factors.empty()) {
+        factors.push_back(m);
+    }
+    twiddles.resize(n);
+    for (int k = 0; k < n; ++k) {
+        double phase = -2*M_PI*k/n;
+        twiddles[k] = Complex(cos(phase), sin(phase));
+    }
+} // init
+
+void ZonalFFT::
+forward(const Complex *in, Complex *out) const {
+    transform(in, out, n, 1, 0, false);
+} // forward
+
+void ZonalFFT::
+backward(const Complex *in, Complex *out) const {
+    transform(in, out, n, 1, 0, true);
+    for (int i = 0; i < n; ++i) {
+        out[i] /= n;
+    }
+} // backward
+
+/**
+ *  Transform the m points of the input with the given stride into the
+ *  contiguous output. The subsequences of every p-th point are transformed
+ *  first into the p blocks of the output, and then they are combined by
+ *
+ *      X(k+sm/p) = ∑_q Y_q(k) W^{q(k+sm/p)}, W = exp(-2πi/m).
+ */
+void ZonalFFT::
+transform(const Complex *in, Complex *out, int m, int stride, int factorIdx,
+          bool inverse) const {
+    int p = factors[factorIdx];
+    int subm = m/p;
+    if (subm == 1) {
+        for (int q = 0; q < p; ++q) {
+            out[q] = in[q*stride];
+        }
+    } else {
+        for (int q = 0; q < p; ++q) {
+            transform(in+q*stride, out+q*subm, subm, stride*p, factorIdx+1, inverse);
+        }
+    }
+    // Note: The large prime factors are rare, so only they allocate scratch.
+    Complex small[8];
+    vector<Complex> large;
+    Complex *y = small;
+    if (p > 8) {
+        large.resize(p);
+        y = &large[0];
+    }
+    int twiddleStride = n/m;
+    for (int k = 0; k < subm; ++k) {
+        for (int q = 0; q < p; ++q) {
+            y[q] = out[q*subm+k];
+        }
+        for (int s = 0; s < p; ++s) {
+            Complex sum = y[0];
+            for (int q = 1; q < p; ++q) {
+                const Complex &w = twiddles[(q*(k+s*subm)%m)*twiddleStride];
+                sum += y[q]*(inverse ? std::conj(w) : w);
+            }
+            out[s*subm+k] = sum;
+        }
+    }
+} // transform
+
+} // barotropic_model
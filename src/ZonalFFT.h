@@ -0,0 +1,56 @@
+#ifndef __ZonalFFT__
+#define __ZonalFFT__
+
+#include "barotropic_model_commons.h"
+#include <complex>
+
+namespace barotropic_model {
+
+/**
+ *  This class is a mixed-radix fast Fourier transform along one latitude
+ *  row. The length is split into prime factors (2, 3, 5, ... first), and the
+ *  transform recursively decimates in time with a direct DFT butterfly for
+ *  each factor, so any length works and the cost is O(N ∑pᵢ). The transforms
+ *  are const, so one plan can be used by many threads at once.
+ *
+ *  The forward transform is
+ *
+ *      X(m) = ∑ x(i) exp(-2πi im/N),
+ *
+ *  and the backward transform is its inverse (scaled by 1/N).
+ */
+class ZonalFFT {
+public:
+    typedef std::complex<double> Complex;
+private:
+    int n;
+    vector<int> factors;
+    vector<Complex> twiddles;   //>! exp(-2πi k/N) for k = 0, ..., N-1
+public:
+    ZonalFFT() : n(0) {}
+
+    void
+    init(int n);
+
+    int
+    size() const {
+        return n;
+    }
+
+    /**
+     *  Transform the input into the output (they must not overlap).
+     */
+    void
+    forward(const Complex *in, Complex *out) const;
+
+    void
+    backward(const Complex *in, Complex *out) const;
+private:
+    void
+    transform(const Complex *in, Complex *out, int m, int stride,
+              int factorIdx, bool inverse) const;
+}; // ZonalFFT
+
+} // barotropic_model
+
+#endif // __ZonalFFT__
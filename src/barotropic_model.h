@@ -3,8 +3,20 @@
 
 #include "barotropic_model.h"
 #include "BarotropicModel.h"
+#include "PyramidOutput.h"
+#include "StationOutput.h"
+#include "StateStream.h"
+#include "ForcingStream.h"
+#include "TaskGraph.h"
 #include "BarotropicModel_A_ImplicitMidpoint.h"
 #include "BarotropicModel_C_ImplicitMidpoint.h"
+#include "BarotropicModel_A_SemiImplicit.h"
+#include "PararealDriver.h"
+#include "EnsembleFork.h"
+#include "NestedRefinement.h"
+#include "SweepRunner.h"
+#include "Autotuner.h"
+#include "PerfRegression.h"
 #include "BarotropicTestCase.h"
 #include "RossbyHaurwitzTestCase.h"
 #include "ToyTestCase.h"
@@ -2,21 +2,304 @@
 
 using namespace barotropic_model;
 
+/**
+ *  Usage: run_model [--lean-memory] [--reduced-grid]
+ *                   [--huge-pages <thp|explicit>] [--perf]
+ *                   [--peak-bandwidth <GB/s>]
+ *                   [--parareal <slices>] [--parareal-threads <threads>]
+ *                   [--autotune <profile>] [--semi-implicit]
+ *                   [--time-step <seconds>] [--pyramid <levels>]
+ *                   [--stations <file>] [--no-field-output]
+ *                   [--stream <name>] [--stream-decimation <d>]
+ *                   [--task-graph <threads>] [--task-band <rows>]
+ *                   [--nest <lon0> <lon1> <lat0> <lat1>] [--nest-ratio <r>]
+ *                   [--ensemble <members>] [--spin-up <steps>]
+ *                   [--ensemble-processes <processes>]
+ *                   [--perturbation <amplitude>] [--forcing <index>]
+ *
+ *  --lean-memory     store only the prognostic time levels and compute the
+ *                    half-level and transformed variables on the fly,
+ *  --reduced-grid    merge the cells on the high-latitude rows into blocks, so
+ *                    that a larger time step can be used,
+ *  --huge-pages      back the memory arena of the model by transparent or
+ *                    explicit huge pages,
+ *  --perf            sample hardware performance counters around each stage of
+ *                    the step and print a report at the end,
+ *  --peak-bandwidth  machine peak memory bandwidth used in the report,
+ *  --parareal        integrate in parallel in time over the given number of
+ *                    slices (see PararealDriver), print the convergence trace,
+ *                    and write only the initial and final states,
+ *  --parareal-threads
+ *                    number of threads for the fine propagators,
+ *  --autotune        tune the threads, memory-lean mode and huge pages by trial
+ *                    steps of the model variant of the run (see Autotuner), or
+ *                    take them from the profile file if it has an entry for
+ *                    this CPU, variant and mesh; this overrides --lean-memory
+ *                    and --huge-pages,
+ *  --semi-implicit   use the semi-implicit model, which allows a several times
+ *                    larger time step (see BarotropicModel_A_SemiImplicit),
+ *  --time-step       time step in seconds (240 by default),
+ *  --pyramid         also write the given number of 2x coarsened levels and a
+ *                    time index of the frames (see PyramidOutput),
+ *  --stations        sample u, v and gd at the stations and along the transects
+ *                    in the file at every step into "output.stations" (see
+ *                    StationOutput),
+ *  --no-field-output do not write the full-field output files,
+ *  --stream          publish the state after every step into the shared memory
+ *                    stream of the given name, e.g. "/barotropic-model", for
+ *                    live monitoring (see StateStream and run_stream_monitor),
+ *  --stream-decimation
+ *                    take every d-th cell along both directions in the stream,
+ *  --task-graph      run each iteration as a graph of tasks on bands of rows on
+ *                    the given number of threads, instead of OpenMP stages,
+ *  --task-band       number of latitude rows in one band of the task graph (4
+ *                    by default),
+ *  --nest            refine the region in degrees by a two-way nested patch
+ *                    (see NestedRefinement), which is written into
+ *                    "output.nest.*.nc",
+ *  --nest-ratio      mesh and time step ratio of the nested patch (odd, 3 by
+ *                    default),
+ *  --ensemble        fork the given number of perturbed members from the state
+ *                    after the spin-up (see EnsembleFork), each of which writes
+ *                    its output files with the prefix "output.member<m>",
+ *  --spin-up         steps of the spin-up before the ensemble (0 by default),
+ *  --ensemble-processes
+ *                    number of members running at once (as many as the
+ *                    threads by default),
+ *  --perturbation    relative amplitude of the random perturbation of the
+ *                    geopotential depth of the members (1.0e-4 by default),
+ *  --forcing         apply the time-varying surface geopotential and forcing
+ *                    tendencies listed in the index file along the run (see
+ *                    ForcingStream).
+ */
 int main(int argc, const char *argv[])
 {
-    BarotropicModel_A_ImplicitMidpoint model;
+    bool useLeanMemory = false;
+    bool useReducedGrid = false;
+    MemoryArena::HugePageMode hugePageMode = MemoryArena::NO_HUGE_PAGE;
+    bool usePerf = false;
+    double peakBandwidth = 0;
+    int numSlice = 0, numPararealThread = 0;
+    string profileFileName;
+    bool useSemiImplicit = false;
+    int timeStep = 240;
+    int numPyramidLevel = 0;
+    string stationFileName;
+    bool useFieldOutput = true;
+    string streamName;
+    int streamDecimation = 1;
+    int numTaskThread = 0, taskBandSize = 4;
+    bool useNest = false;
+    double nestRegion[4];
+    int nestRatio = 3;
+    int numMember = 0, numSpinUpStep = 0, numMemberProcess = 0;
+    double perturbation = 1.0e-4;
+    string forcingFileName;
+    for (int i = 1; i < argc; ++i) {
+        string arg(argv[i]);
+        if (arg == "--lean-memory") {
+            useLeanMemory = true;
+        } else if (arg == "--reduced-grid") {
+            useReducedGrid = true;
+        } else if (arg == "--huge-pages" && i+1 < argc) {
+            string mode(argv[++i]);
+            if (mode == "thp") {
+                hugePageMode = MemoryArena::TRANSPARENT_HUGE_PAGE;
+            } else if (mode == "explicit") {
+                hugePageMode = MemoryArena::EXPLICIT_HUGE_PAGE;
+            } else {
+                REPORT_ERROR("Unknown huge page mode \"" << mode << "\"!");
+            }
+        } else if (arg == "--perf") {
+            usePerf = true;
+        } else if (arg == "--peak-bandwidth" && i+1 < argc) {
+            peakBandwidth = atof(argv[++i]);
+        } else if (arg == "--parareal" && i+1 < argc) {
+            numSlice = atoi(argv[++i]);
+        } else if (arg == "--parareal-threads" && i+1 < argc) {
+            numPararealThread = atoi(argv[++i]);
+        } else if (arg == "--autotune" && i+1 < argc) {
+            profileFileName = argv[++i];
+        } else if (arg == "--semi-implicit") {
+            useSemiImplicit = true;
+        } else if (arg == "--time-step" && i+1 < argc) {
+            timeStep = atoi(argv[++i]);
+        } else if (arg == "--pyramid" && i+1 < argc) {
+            numPyramidLevel = atoi(argv[++i]);
+        } else if (arg == "--stations" && i+1 < argc) {
+            stationFileName = argv[++i];
+        } else if (arg == "--no-field-output") {
+            useFieldOutput = false;
+        } else if (arg == "--stream" && i+1 < argc) {
+            streamName = argv[++i];
+        } else if (arg == "--stream-decimation" && i+1 < argc) {
+            streamDecimation = atoi(argv[++i]);
+        } else if (arg == "--task-graph" && i+1 < argc) {
+            numTaskThread = atoi(argv[++i]);
+        } else if (arg == "--task-band" && i+1 < argc) {
+            taskBandSize = atoi(argv[++i]);
+        } else if (arg == "--nest" && i+4 < argc) {
+            useNest = true;
+            for (int k = 0; k < 4; ++k) {
+                nestRegion[k] = atof(argv[++i]);
+            }
+        } else if (arg == "--nest-ratio" && i+1 < argc) {
+            nestRatio = atoi(argv[++i]);
+        } else if (arg == "--ensemble" && i+1 < argc) {
+            numMember = atoi(argv[++i]);
+        } else if (arg == "--spin-up" && i+1 < argc) {
+            numSpinUpStep = atoi(argv[++i]);
+        } else if (arg == "--ensemble-processes" && i+1 < argc) {
+            numMemberProcess = atoi(argv[++i]);
+        } else if (arg == "--perturbation" && i+1 < argc) {
+            perturbation = atof(argv[++i]);
+        } else if (arg == "--forcing" && i+1 < argc) {
+            forcingFileName = argv[++i];
+        } else {
+            REPORT_ERROR("Unknown argument \"" << arg << "\"!");
+        }
+    }
+
+    if (useSemiImplicit && numSlice > 0) {
+        REPORT_ERROR("Parareal does not support the semi-implicit model!");
+    }
+    if (useSemiImplicit && numTaskThread > 0) {
+        REPORT_ERROR("Task graph does not support the semi-implicit model!");
+    }
+    if (numMember > 0 && (numSlice > 0 || numTaskThread > 0 ||
+                          !streamName.empty())) {
+        REPORT_ERROR("Ensemble does not support parareal, task graph or "
+                     "stream!");
+    }
+    // Note: The forcing is applied by run(), and its reading thread would
+    //       not exist in the ensemble members. It is not applied to the
+    //       nested patch either, which would then feed back an unforced state.
+    if (!forcingFileName.empty() && (numSlice > 0 || numMember > 0 || useNest)) {
+        REPORT_ERROR("Forcing stream does not support parareal, ensemble or "
+                     "nested refinement!");
+    }
+    if (useNest && (useSemiImplicit || numSlice > 0)) {
+        REPORT_ERROR("Nested refinement does not support the semi-implicit "
+                     "model or parareal!");
+    }
+
+    const int numLon = 80, numLat = 41;
+    // Create the model variant of the run, which is also used by the trials
+    // of the autotuner.
+    auto createModel = [=] () {
+        BarotropicModel_A_ImplicitMidpoint *model;
+        if (useSemiImplicit) {
+            model = new BarotropicModel_A_SemiImplicit;
+        } else {
+            model = new BarotropicModel_A_ImplicitMidpoint;
+        }
+        model->setReducedGrid(useReducedGrid);
+        model->setTaskGraph(numTaskThread, taskBandSize);
+        return model;
+    };
+    BarotropicModel_A_ImplicitMidpoint *model = createModel();
     RossbyHaurwitzTestCase testCase;
 
     TimeManager timeManager;
     ptime startTime(date(2000, 1, 1));
     ptime endTime = startTime+days(120);
 
-    timeManager.init(startTime, endTime, minutes(4));
+    timeManager.init(startTime, endTime, seconds(timeStep));
+
+    if (useLeanMemory) {
+        model->setLeanMemory(true);
+    }
+    model->setHugePageMode(hugePageMode);
+    model->setPyramidOutput(numPyramidLevel);
+    model->setStationOutput(stationFileName);
+    model->setFieldOutput(useFieldOutput);
+    model->setStateStream(streamName, streamDecimation);
+    if (!profileFileName.empty()) {
+        std::ostringstream variant;
+        variant << (useSemiImplicit ? "semi-implicit" : "implicit");
+        if (useReducedGrid) {
+            variant << "+reduced-grid";
+        }
+        if (numTaskThread > 0) {
+            variant << "+task-graph-" << numTaskThread << "x" << taskBandSize;
+        }
+        Autotuner tuner(profileFileName);
+        // Note: The semi-implicit scheme does not conserve the total energy
+        //       exactly, so only its blow-up is caught.
+        if (useSemiImplicit) {
+            tuner.setTolerance(1.0e-4);
+        }
+        Autotuner::Config config = tuner.tune(variant.str(), numLon, numLat,
+            timeManager.stepSizeInSeconds(), createModel,
+            [&testCase] (BarotropicModel &trialModel) {
+                testCase.calcInitCond(trialModel);
+            });
+        Autotuner::apply(config, *model);
+    }
+    model->init(timeManager, numLon, numLat);
+    testCase.calcInitCond(*model);
+
+    NestedRefinement nest;
+    if (useNest) {
+        nest.setRefinement(nestRatio, nestRatio);
+        nest.setRegion(nestRegion[0], nestRegion[1], nestRegion[2], nestRegion[3]);
+        nest.init(*model, timeManager);
+        testCase.calcInitCond(nest.childModel());
+        nest.feedback(true);
+        model->setNestedRefinement(&nest);
+    }
+
+    ForcingStream forcingStream;
+    if (!forcingFileName.empty()) {
+        forcingStream.init(*model, forcingFileName);
+        model->setForcingStream(&forcingStream);
+    }
+
+    if (usePerf) {
+        model->perfCounters().enable(peakBandwidth);
+    }
 
-    model.init(timeManager, 80, 41);
-    testCase.calcInitCond(model);
+    if (numSlice > 0) {
+        PararealDriver driver;
+        driver.setNumSlice(numSlice);
+        if (numPararealThread > 0) {
+            driver.setNumThread(numPararealThread);
+        }
+        double dt = timeManager.stepSizeInSeconds();
+        int numStep = (endTime-startTime).total_seconds()/dt;
+        model->output();
+        driver.run(*model, numStep, dt);
+        // The final state is at the end time.
+        for (int n = 0; n < numStep; ++n) {
+            timeManager.advance();
+        }
+        model->output();
+    } else if (numMember > 0) {
+        model->initialize();
+        if (numSpinUpStep > 0) {
+            model->step(numSpinUpStep);
+        }
+        EnsembleFork ensemble;
+        ensemble.setNumMember(numMember);
+        ensemble.setMaxNumProcess(numMemberProcess);
+        int numFailed = ensemble.run(*model,
+            [perturbation] (BarotropicModel_A_ImplicitMidpoint &member, int m) {
+                EnsembleFork::perturbGeopotentialDepth(member, m, perturbation);
+            },
+            [] (BarotropicModel_A_ImplicitMidpoint &member, int m) {
+                std::ostringstream prefix;
+                prefix << "output.member" << setw(3) << std::setfill('0') << m;
+                member.setOutputPrefix(prefix.str());
+                member.run();
+            });
+        if (numFailed > 0) {
+            REPORT_ERROR(numFailed << " ensemble members failed!");
+        }
+    } else {
+        model->run();
+    }
 
-    model.run();
+    delete model;
 
     return 0;
 }
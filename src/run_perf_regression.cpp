@@ -0,0 +1,71 @@
+#include "barotropic_model.h"
+
+using namespace barotropic_model;
+
+/**
+ *  Usage: run_perf_regression <baseline> [--update] [--steps <steps>]
+ *                             [--time-tolerance <ratio>]
+ *                             [--iteration-tolerance <ratio>]
+ *                             [--conservation-tolerance <ratio>]
+ *
+ *  Run the fixed cases of the performance regression harness, compare them
+ *  with the baselines of this machine in the baseline file (see
+ *  PerfRegression for the format), and exit with 1 if any case regresses,
+ *  or with 77 (skipped for ctest) if the file has no baseline of this machine
+ *  and the conservation passes.
+ *
+ *  --update          replace the baselines of this machine by the results,
+ *  --steps           steps in one timed repeat of each case (30 by default),
+ *  --time-tolerance  allowed relative growth of the time per step and of each
+ *                    stage (0.2 by default),
+ *  --iteration-tolerance
+ *                    allowed relative growth of the iterations per step (0.1
+ *                    by default),
+ *  --conservation-tolerance
+ *                    allowed relative drift of the total energy and mass, and
+ *                    deviation from the baseline (1.0e-10 by default).
+ */
+int main(int argc, const char *argv[])
+{
+    string baselineFileName;
+    bool updateBaseline = false;
+    int numStep = 30;
+    double timeTolerance = 0.2;
+    double iterationTolerance = 0.1;
+    double conservationTolerance = 1.0e-10;
+    for (int i = 1; i < argc; ++i) {
+        string arg(argv[i]);
+        if (arg == "--update") {
+            updateBaseline = true;
+        } else if (arg == "--steps" && i+1 < argc) {
+            numStep = atoi(argv[++i]);
+        } else if (arg == "--time-tolerance" && i+1 < argc) {
+            timeTolerance = atof(argv[++i]);
+        } else if (arg == "--iteration-tolerance" && i+1 < argc) {
+            iterationTolerance = atof(argv[++i]);
+        } else if (arg == "--conservation-tolerance" && i+1 < argc) {
+            conservationTolerance = atof(argv[++i]);
+        } else if (arg[0] != '-' && baselineFileName.empty()) {
+            baselineFileName = arg;
+        } else {
+            REPORT_ERROR("Unknown argument \"" << arg << "\"!");
+        }
+    }
+    if (baselineFileName.empty()) {
+        REPORT_ERROR("Usage: run_perf_regression <baseline> [--update] " <<
+                     "[--steps <steps>] [--time-tolerance <ratio>] " <<
+                     "[--iteration-tolerance <ratio>] " <<
+                     "[--conservation-tolerance <ratio>]");
+    }
+
+    PerfRegression regression(baselineFileName);
+    regression.addDefaultCases(numStep);
+    regression.setTolerance(timeTolerance, iterationTolerance,
+                            conservationTolerance);
+    PerfRegression::Status status = regression.run(updateBaseline);
+
+    if (status == PerfRegression::SKIPPED) {
+        return 77;
+    }
+    return status == PerfRegression::PASSED ? 0 : 1;
+}
@@ -0,0 +1,70 @@
+#include "barotropic_model.h"
+#include <chrono>
+#include <thread>
+
+using namespace barotropic_model;
+
+/**
+ *  Usage: run_stream_monitor <name> [--poll <ms>] [--count <snapshots>]
+ *
+ *  Follow the shared memory stream of a running model (see StateStream and
+ *  the --stream option of run_model), and print the range of each field of
+ *  the latest snapshot whenever a new one is published.
+ *
+ *  --poll   polling interval in milliseconds (100 by default),
+ *  --count  exit after printing the given number of snapshots.
+ */
+int main(int argc, const char *argv[])
+{
+    string name;
+    int pollInterval = 100;
+    int maxCount = -1;
+    for (int i = 1; i < argc; ++i) {
+        string arg(argv[i]);
+        if (arg == "--poll" && i+1 < argc) {
+            pollInterval = atoi(argv[++i]);
+        } else if (arg == "--count" && i+1 < argc) {
+            maxCount = atoi(argv[++i]);
+        } else if (arg[0] != '-' && name.empty()) {
+            name = arg;
+        } else {
+            REPORT_ERROR("Unknown argument \"" << arg << "\"!");
+        }
+    }
+    if (name.empty()) {
+        REPORT_ERROR("Stream name is not given!");
+    }
+
+    const char *fieldNames[] = {"u", "v", "gd"};
+    StateStream stream;
+    stream.open(name);
+    cout << "Stream \"" << name << "\": " << stream.streamHeader().numLon <<
+        "x" << stream.streamHeader().numLat << " cells, decimation " <<
+        stream.streamHeader().decimation << endl;
+    StateStream::Snapshot snapshot;
+    int count = 0;
+    while (maxCount < 0 || count < maxCount) {
+        if (!stream.readLatest(snapshot)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(pollInterval));
+            continue;
+        }
+        ++count;
+        cout << "step " << setw(7) << snapshot.step << " " << setw(10) <<
+            fixed << setprecision(0) << snapshot.elapsedSeconds << " s";
+        int size = snapshot.numLon*snapshot.numLat;
+        for (int f = 0; f < snapshot.fieldIds.size(); ++f) {
+            const float *data = &snapshot.data[f*size];
+            float minValue = data[0], maxValue = data[0];
+            for (int k = 1; k < size; ++k) {
+                minValue = std::min(minValue, data[k]);
+                maxValue = std::max(maxValue, data[k]);
+            }
+            int id = snapshot.fieldIds[f];
+            cout << "  " << (id < 3 ? fieldNames[id] : "?") << " [" <<
+                setprecision(2) << minValue << ", " << maxValue << "]";
+        }
+        cout << endl;
+    }
+
+    return 0;
+}
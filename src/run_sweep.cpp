@@ -0,0 +1,44 @@
+#include "barotropic_model.h"
+
+using namespace barotropic_model;
+
+/**
+ *  Usage: run_sweep <matrix> [--threads <threads>] [--summary <file>]
+ *
+ *  Run the model configurations in the run matrix concurrently (see
+ *  SweepRunner for the matrix format), and print the summary table.
+ *
+ *  --threads  number of concurrent runs (hardware concurrency by default),
+ *  --summary  also write the summary table into the given file.
+ */
+int main(int argc, const char *argv[])
+{
+    string matrixFileName, summaryFileName;
+    int numThread = 0;
+    for (int i = 1; i < argc; ++i) {
+        string arg(argv[i]);
+        if (arg == "--threads" && i+1 < argc) {
+            numThread = atoi(argv[++i]);
+        } else if (arg == "--summary" && i+1 < argc) {
+            summaryFileName = argv[++i];
+        } else if (arg[0] != '-' && matrixFileName.empty()) {
+            matrixFileName = arg;
+        } else {
+            REPORT_ERROR("Unknown argument \"" << arg << "\"!");
+        }
+    }
+    if (matrixFileName.empty()) {
+        REPORT_ERROR("Usage: run_sweep <matrix> [--threads <threads>] " <<
+                     "[--summary <file>]");
+    }
+
+    SweepRunner runner;
+    runner.readMatrix(matrixFileName);
+    runner.run(numThread);
+    runner.writeSummary(cout);
+    if (!summaryFileName.empty()) {
+        runner.writeSummary(summaryFileName);
+    }
+
+    return 0;
+}
@@ -0,0 +1,46 @@
+#ifndef __test_common__
+#define __test_common__
+
+#include "barotropic_model.h"
+
+namespace barotropic_model {
+
+/**
+ *  The common fixture of the smoke tests in "test_<name>.cpp", which run the
+ *  models quietly on the 80x41 mesh with 240 s steps from 2000-01-01.
+ */
+
+const int TEST_NUM_LON = 80, TEST_NUM_LAT = 41;
+const int TEST_TIME_STEP = 240;
+
+/**
+ *  Initialize the configured model for the given number of steps, and set
+ *  its initial condition by the test case. The model still needs
+ *  initialize(), so that a nested refinement can be set up before it.
+ */
+template <class TestCase>
+void
+setUpTestModel(BarotropicModel_A_ImplicitMidpoint &model,
+               TimeManager &timeManager, TestCase &testCase, int numStep) {
+    ptime startTime(date(2000, 1, 1));
+    timeManager.init(startTime, startTime+seconds(TEST_TIME_STEP*numStep),
+                     seconds(TEST_TIME_STEP));
+    model.setVerbose(false);
+    model.init(timeManager, TEST_NUM_LON, TEST_NUM_LAT);
+    testCase.calcInitCond(model);
+} // setUpTestModel
+
+/**
+ *  Set up the configured model as setUpTestModel(), and initialize it.
+ */
+template <class TestCase>
+void
+initTestModel(BarotropicModel_A_ImplicitMidpoint &model,
+              TimeManager &timeManager, TestCase &testCase, int numStep) {
+    setUpTestModel(model, timeManager, testCase, numStep);
+    model.initialize();
+} // initTestModel
+
+} // barotropic_model
+
+#endif // __test_common__
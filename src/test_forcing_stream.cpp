@@ -0,0 +1,151 @@
+#include "test_common.h"
+#include <fstream>
+#include <unistd.h>
+
+using namespace barotropic_model;
+
+/**
+ *  Usage: test_forcing_stream
+ *
+ *  Check the interpolation in time of ForcingStream: three records of the
+ *  surface geopotential and the forcing tendencies of u and gd are written
+ *  into a temporary directory, and the model must get the records at their
+ *  times, the linear interpolation between them, the first record before
+ *  them and the last one after them. The model must be left alone when the
+ *  forcing does not change.
+ */
+
+const int NUM_RECORD = 3;
+const double RECORD_SECONDS[NUM_RECORD] = {0, 3600, 7200};
+
+/**
+ *  Return the value of the variable (0 for ghs, 1 for fu and 2 for fgd) in
+ *  the given record, which varies along both directions.
+ */
+double
+recordValue(int variable, int record, int i, int j) {
+    switch (variable) {
+        case 0: return 1000*(record+1)+10*i+j;
+        case 1: return 1.0e-5*(record-1)*(i+1);
+        default: return -1.0e-4*(record+1)*(j+1);
+    }
+} // recordValue
+
+double
+expectedValue(int variable, double seconds, int i, int j) {
+    if (seconds <= RECORD_SECONDS[0]) {
+        return recordValue(variable, 0, i, j);
+    }
+    for (int k = 0; k < NUM_RECORD-1; ++k) {
+        if (seconds < RECORD_SECONDS[k+1]) {
+            double weight = (seconds-RECORD_SECONDS[k])/
+                            (RECORD_SECONDS[k+1]-RECORD_SECONDS[k]);
+            return (1-weight)*recordValue(variable, k, i, j)+
+                   weight*recordValue(variable, k+1, i, j);
+        }
+    }
+    return recordValue(variable, NUM_RECORD-1, i, j);
+} // expectedValue
+
+void
+writeRecords(const string &dirName) {
+    std::ofstream index((dirName+"/index").c_str());
+    index << "# smoke test" << endl;
+    index << "variables ghs fu fgd" << endl;
+    for (int k = 0; k < NUM_RECORD; ++k) {
+        std::ostringstream fileName;
+        fileName << "record" << k << ".bin";
+        index << "record " << RECORD_SECONDS[k] << " " << fileName.str() << endl;
+        std::ofstream file((dirName+"/"+fileName.str()).c_str(),
+                           std::ios::binary);
+        for (int l = 0; l < 3; ++l) {
+            for (int j = 0; j < TEST_NUM_LAT; ++j) {
+                for (int i = 0; i < TEST_NUM_LON; ++i) {
+                    double value = recordValue(l, k, i, j);
+                    file.write(reinterpret_cast<const char*>(&value),
+                               sizeof(value));
+                }
+            }
+        }
+    }
+} // writeRecords
+
+void
+removeRecords(const string &dirName) {
+    std::remove((dirName+"/index").c_str());
+    for (int k = 0; k < NUM_RECORD; ++k) {
+        std::ostringstream fileName;
+        fileName << dirName << "/record" << k << ".bin";
+        std::remove(fileName.str().c_str());
+    }
+    rmdir(dirName.c_str());
+} // removeRecords
+
+/**
+ *  Return the number of values that differ from the expected ones. The
+ *  forcing on the Poles is skipped, since the model changes it.
+ */
+int
+checkForcing(BarotropicModel &model, double seconds) {
+    FieldView ghs = model.surfaceGeopotentialView();
+    BarotropicModel::ForcingView forcing = model.forcing();
+    int numDifferent = 0;
+    for (int j = 0; j < TEST_NUM_LAT; ++j) {
+        for (int i = 0; i < TEST_NUM_LON; ++i) {
+            if (ghs(i, j) != expectedValue(0, seconds, i, j)) {
+                ++numDifferent;
+            }
+            if (j == 0 || j == TEST_NUM_LAT-1) {
+                continue;
+            }
+            if (forcing.u(i, j) != expectedValue(1, seconds, i, j) ||
+                forcing.v(i, j) != 0 ||
+                forcing.gd(i, j) != expectedValue(2, seconds, i, j)) {
+                ++numDifferent;
+            }
+        }
+    }
+    return numDifferent;
+} // checkForcing
+
+int main()
+{
+    char dirName[] = "/tmp/barotropic-model-test-XXXXXX";
+    if (mkdtemp(dirName) == NULL) {
+        REPORT_ERROR("Failed to create a temporary directory!");
+    }
+    writeRecords(dirName);
+
+    BarotropicModel_A_ImplicitMidpoint model;
+    RossbyHaurwitzTestCase testCase;
+    TimeManager timeManager;
+    initTestModel(model, timeManager, testCase, 3*3600/TEST_TIME_STEP);
+    ForcingStream stream;
+    stream.init(model, string(dirName)+"/index");
+
+    const double seconds[] = {-600, 0, 900, 3600, 5400, 7200, 9000};
+    int numFailed = 0;
+    for (int k = 0; k < sizeof(seconds)/sizeof(double); ++k) {
+        stream.update(seconds[k]);
+        int numDifferent = checkForcing(model, seconds[k]);
+        cout << "at " << seconds[k] << " s: " << numDifferent <<
+            " different values" << endl;
+        if (numDifferent > 0) {
+            ++numFailed;
+        }
+    }
+    // After the last record, the forcing does not change any more.
+    model.surfaceGeopotentialView()(0, 10) = -1;
+    stream.update(10800);
+    if (model.surfaceGeopotentialView()(0, 10) != -1) {
+        cout << "model is touched by an unchanged forcing" << endl;
+        ++numFailed;
+    }
+    removeRecords(dirName);
+
+    if (numFailed > 0) {
+        REPORT_ERROR("Forcing stream fails " << numFailed << " checks!");
+    }
+
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include "test_common.h"
+
+using namespace barotropic_model;
+
+/**
+ *  Usage: test_lean_memory
+ *
+ *  Check the memory-lean mode against the full mode on the toy test case,
+ *  whose topography exercises the terms of the surface geopotential. With one
+ *  fixed-point iteration per step, both modes evaluate the same operations on
+ *  the same values (the full mode transforms the state again at each step),
+ *  so their states must be bit-identical. With more iterations, the full mode
+ *  reads back the transformed winds of the last iteration, where the
+ *  memory-lean mode derives them from the winds and the latest geopotential
+ *  depth, so they only agree to the convergence of the iterations.
+ */
+
+void
+runModel(bool leanMemory, int maxIteration, int numStep,
+         vector<double> &state) {
+    BarotropicModel_A_ImplicitMidpoint model;
+    ToyTestCase testCase;
+    TimeManager timeManager;
+    model.setLeanMemory(leanMemory);
+    model.setMaxIteration(maxIteration);
+    initTestModel(model, timeManager, testCase, numStep);
+    model.step(numStep);
+    BarotropicModel::StateView view = model.state();
+    state.clear();
+    for (int j = 0; j < view.gd.numLat(); ++j) {
+        for (int i = 0; i < view.gd.numLon(); ++i) {
+            state.push_back(view.u(i, j));
+            state.push_back(view.v(i, j));
+            state.push_back(view.gd(i, j));
+        }
+    }
+} // runModel
+
+double
+calcMaxDifference(const vector<double> &a, const vector<double> &b) {
+    double difference = 0;
+    for (int k = 0; k < a.size(); ++k) {
+        difference = std::max(difference, fabs(a[k]-b[k])/
+                              std::max(fabs(b[k]), 1.0));
+    }
+    return difference;
+} // calcMaxDifference
+
+int main()
+{
+    vector<double> full, lean;
+
+    runModel(false, 1, 20, full);
+    runModel(true, 1, 20, lean);
+    double difference = calcMaxDifference(lean, full);
+    cout << "one iteration: max difference " << std::scientific <<
+        setprecision(2) << difference << std::defaultfloat << endl;
+    if (difference != 0) {
+        REPORT_ERROR("Memory-lean mode is not bit-identical to the full mode!");
+    }
+
+    runModel(false, 8, 20, full);
+    runModel(true, 8, 20, lean);
+    difference = calcMaxDifference(lean, full);
+    cout << "eight iterations: max difference " << std::scientific <<
+        setprecision(2) << difference << std::defaultfloat << endl;
+    if (difference > 1.0e-6) {
+        REPORT_ERROR("Memory-lean mode deviates from the full mode!");
+    }
+
+    return 0;
+}
@@ -0,0 +1,152 @@
+#include "test_common.h"
+
+using namespace barotropic_model;
+
+/**
+ *  Usage: test_nested_refinement
+ *
+ *  Check a nested refinement over the topography of the toy test case, for
+ *  a few mesh and time step ratios and regions, with the child interpolated
+ *  from the parent or given its own initial condition:
+ *
+ *  - The interpolated child must equal the parent on the child cells that
+ *    coincide with the parent cells.
+ *  - The parent must conserve its total mass, which only drifts by
+ *    round-off, since the feedback scales the mean geopotential depths of
+ *    the child to the mass of the parent over them.
+ *  - The mass of the child over the blocks that are fed back must stay
+ *    close to the one of the parent over them. This is not ensured by the
+ *    scaling of the feedback, so it catches a child that is not integrated
+ *    or drifts away from the parent (an inactive child is off by more than
+ *    one percent after 20 steps).
+ */
+
+struct Patch {
+    int is, ie, js, je;     //>! parent cells fed back by the child
+};
+
+/**
+ *  Return the parent cells that are fed back by the child, which are the
+ *  cells whose centers are in the region, except the outermost ones.
+ */
+Patch
+calcPatch(const double region[4], int numLon, int numLat) {
+    const double eps = 1.0e-10;
+    double dlon = 360.0/numLon, dlat = 180.0/(numLat-1);
+    Patch patch;
+    patch.is = static_cast<int>(ceil(region[0]/dlon-eps))+1;
+    patch.ie = static_cast<int>(floor(region[1]/dlon+eps))-1;
+    patch.js = static_cast<int>(ceil((region[2]+90)/dlat-eps))+1;
+    patch.je = static_cast<int>(floor((region[3]+90)/dlat+eps))-1;
+    return patch;
+} // calcPatch
+
+/**
+ *  Return the mass over the blocks of the patch on a mesh refined by the
+ *  given ratio (1 for the parent), in the units of the parent cells.
+ */
+double
+calcPatchMass(const ConstFieldView &gd, const Patch &patch, int meshRatio) {
+    int h = meshRatio/2;
+    double dlat = M_PI/(gd.numLat()-1);
+    double mass = 0;
+    for (int j = patch.js*meshRatio-h; j <= patch.je*meshRatio+h; ++j) {
+        double cosLat = cos(-M_PI_2+j*dlat);
+        for (int i = patch.is*meshRatio-h; i <= patch.ie*meshRatio+h; ++i) {
+            mass += gd(i, j)*cosLat;
+        }
+    }
+    return mass/(meshRatio*meshRatio);
+} // calcPatchMass
+
+/**
+ *  Return the number of child cells on the parent cells with other values.
+ */
+int
+countCoincidingDifferences(BarotropicModel &parent, BarotropicModel &child,
+                           int meshRatio) {
+    BarotropicModel::StateView p = parent.state(), c = child.state();
+    int numDifferent = 0;
+    for (int j = 0; j < p.gd.numLat(); ++j) {
+        for (int i = 0; i < p.gd.numLon(); ++i) {
+            int ci = i*meshRatio, cj = j*meshRatio;
+            if (c.u(ci, cj) != p.u(i, j) || c.v(ci, cj) != p.v(i, j) ||
+                c.gd(ci, cj) != p.gd(i, j)) {
+                ++numDifferent;
+            }
+        }
+    }
+    return numDifferent;
+} // countCoincidingDifferences
+
+/**
+ *  Run the nest, and return the number of failed checks.
+ */
+int
+runNest(int meshRatio, int stepRatio, const double region[4],
+        bool childInitCond, int numStep) {
+    BarotropicModel_A_ImplicitMidpoint model;
+    ToyTestCase testCase;
+    TimeManager timeManager;
+    setUpTestModel(model, timeManager, testCase, numStep);
+    NestedRefinement nest;
+    nest.setRefinement(meshRatio, stepRatio);
+    nest.setRegion(region[0], region[1], region[2], region[3]);
+    nest.init(model, timeManager);
+    BarotropicModel &child = nest.childModel();
+    cout << "mesh ratio " << meshRatio << ", step ratio " << stepRatio <<
+        ", region " << region[0] << "," << region[1] << "," << region[2] <<
+        "," << region[3] << (childInitCond ? ", child initial condition" : "") <<
+        ":" << endl;
+    int numFailed = 0;
+    if (childInitCond) {
+        testCase.calcInitCond(child);
+        nest.feedback(true);
+    } else {
+        int numDifferent = countCoincidingDifferences(model, child, meshRatio);
+        cout << "  " << numDifferent << " child cells differ from the parent" <<
+            endl;
+        if (numDifferent > 0) {
+            ++numFailed;
+        }
+    }
+    model.initialize();
+    double mass0 = model.totalMass();
+    for (int k = 0; k < numStep; ++k) {
+        nest.step();
+    }
+    double massDrift = (model.totalMass()-mass0)/mass0;
+    Patch patch = calcPatch(region, TEST_NUM_LON, TEST_NUM_LAT);
+    double parentMass = calcPatchMass(model.state().gd, patch, 1);
+    double childMass = calcPatchMass(child.state().gd, patch, meshRatio);
+    double massDeviation = (childMass-parentMass)/parentMass;
+    cout << "  mass drift " << std::scientific << setprecision(2) <<
+        massDrift << ", child mass deviation " << massDeviation <<
+        std::defaultfloat << endl;
+    if (!(fabs(massDrift) <= 1.0e-12)) {
+        ++numFailed;
+    }
+    if (!(fabs(massDeviation) <= 2.0e-3)) {
+        ++numFailed;
+    }
+    return numFailed;
+} // runNest
+
+int main()
+{
+    const double smallRegion[4] = {150, 210, 25, 65};
+    const double largeRegion[4] = {60, 300, -60, 70};
+    int numFailed = 0;
+
+    for (int k = 0; k < 4; ++k) {
+        int meshRatio = k < 3 ? 3 : 5;
+        int stepRatio = k < 3 ? 3 : 4;
+        const double *region = k == 2 ? largeRegion : smallRegion;
+        numFailed += runNest(meshRatio, stepRatio, region, k == 1, 20);
+    }
+    if (numFailed > 0) {
+        REPORT_ERROR("Nested refinement fails " << numFailed << " checks!");
+    }
+
+    return 0;
+}
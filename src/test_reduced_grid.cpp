@@ -0,0 +1,59 @@
+#include "test_common.h"
+
+using namespace barotropic_model;
+
+/**
+ *  Usage: test_reduced_grid
+ *
+ *  Check that the reduced-grid mode conserves the total energy and mass on
+ *  the Rossby-Haurwitz wave and the toy test case. The first step projects
+ *  the initial condition onto the blocks of the reduced rows, which changes
+ *  the energy, so the drifts are measured from the state after it.
+ */
+
+void
+calcDrifts(bool toyTestCase, int numStep, double &energyDrift,
+           double &massDrift) {
+    BarotropicModel_A_ImplicitMidpoint model;
+    TimeManager timeManager;
+    model.setReducedGrid(true);
+    if (toyTestCase) {
+        ToyTestCase testCase;
+        initTestModel(model, timeManager, testCase, numStep+1);
+    } else {
+        RossbyHaurwitzTestCase testCase;
+        initTestModel(model, timeManager, testCase, numStep+1);
+    }
+    model.step();
+    double energy0 = model.totalEnergy();
+    double mass0 = model.totalMass();
+    model.step(numStep);
+    energyDrift = (model.totalEnergy()-energy0)/energy0;
+    massDrift = (model.totalMass()-mass0)/mass0;
+    if (energyDrift != energyDrift || massDrift != massDrift) {
+        REPORT_ERROR("Reduced-grid mode blows up!");
+    }
+} // calcDrifts
+
+int main()
+{
+    int numFailed = 0;
+
+    for (int k = 0; k < 2; ++k) {
+        double energyDrift, massDrift;
+        calcDrifts(k == 1, 30, energyDrift, massDrift);
+        cout << (k == 1 ? "toy test case" : "Rossby-Haurwitz wave") <<
+            ": energy drift " << std::scientific << setprecision(2) <<
+            energyDrift << ", mass drift " << massDrift <<
+            std::defaultfloat << endl;
+        if (fabs(energyDrift) > 1.0e-10 || fabs(massDrift) > 1.0e-12) {
+            ++numFailed;
+        }
+    }
+    if (numFailed > 0) {
+        REPORT_ERROR("Reduced-grid mode does not conserve the energy or " <<
+                     "mass in " << numFailed << " runs!");
+    }
+
+    return 0;
+}
@@ -0,0 +1,120 @@
+#include "test_common.h"
+#include <unistd.h>
+
+using namespace barotropic_model;
+
+/**
+ *  Usage: test_state_stream
+ *
+ *  Check the round trip of the model state through the shared memory ring
+ *  buffer of StateStream: a consumer attached to the producer of a
+ *  decimated stream must read nothing before the first snapshot, then the
+ *  latest snapshot (after the ring wraps around) with its time, step and
+ *  the state of the model rounded to floats, and nothing more until the
+ *  next one is published.
+ */
+
+int
+checkSnapshot(const StateStream::Snapshot &snapshot, BarotropicModel &model,
+              int decimation, uint64_t index, uint64_t step) {
+    int numFailed = 0;
+    if (snapshot.index != index || snapshot.step != step ||
+        snapshot.elapsedSeconds != step*double(TEST_TIME_STEP)) {
+        cout << "snapshot " << snapshot.index << " at step " <<
+            snapshot.step << " is not snapshot " << index << " at step " <<
+            step << endl;
+        ++numFailed;
+    }
+    BarotropicModel::StateView view = model.state();
+    int numLon = (view.gd.numLon()+decimation-1)/decimation;
+    int numLat = (view.gd.numLat()+decimation-1)/decimation;
+    if (snapshot.numLon != numLon || snapshot.numLat != numLat ||
+        snapshot.fieldIds.size() != 3 ||
+        snapshot.data.size() != 3*numLon*numLat) {
+        cout << "snapshot has a wrong shape" << endl;
+        return numFailed+1;
+    }
+    const ConstFieldView *fields[3];
+    for (int l = 0; l < 3; ++l) {
+        switch (snapshot.fieldIds[l]) {
+            case StateStream::U: fields[l] = &view.u; break;
+            case StateStream::V: fields[l] = &view.v; break;
+            case StateStream::GD: fields[l] = &view.gd; break;
+            default:
+                cout << "snapshot has an unknown field" << endl;
+                return numFailed+1;
+        }
+    }
+    int numDifferent = 0;
+    for (int l = 0; l < 3; ++l) {
+        for (int j = 0; j < numLat; ++j) {
+            for (int i = 0; i < numLon; ++i) {
+                float value = static_cast<float>(
+                    (*fields[l])(i*decimation, j*decimation));
+                if (snapshot.data[(l*numLat+j)*numLon+i] != value) {
+                    ++numDifferent;
+                }
+            }
+        }
+    }
+    if (numDifferent > 0) {
+        cout << "snapshot differs from the model in " << numDifferent <<
+            " values" << endl;
+        ++numFailed;
+    }
+    return numFailed;
+} // checkSnapshot
+
+int main()
+{
+    const int decimation = 3, numSlot = 4;
+    BarotropicModel_A_ImplicitMidpoint model;
+    RossbyHaurwitzTestCase testCase;
+    TimeManager timeManager;
+    initTestModel(model, timeManager, testCase, 2*numSlot+1);
+
+    std::ostringstream name;
+    name << "/barotropic-model-test-" << getpid();
+    StateStream producer, consumer;
+    producer.create(model, name.str(), decimation, numSlot);
+    consumer.open(name.str());
+    StateStream::Snapshot snapshot;
+    int numFailed = 0;
+
+    if (consumer.readLatest(snapshot)) {
+        cout << "snapshot is read before any is published" << endl;
+        ++numFailed;
+    }
+    producer.publish(0, 0);
+    if (!consumer.readLatest(snapshot)) {
+        cout << "first snapshot is not read" << endl;
+        ++numFailed;
+    } else {
+        numFailed += checkSnapshot(snapshot, model, decimation, 0, 0);
+    }
+    // Publish more snapshots than the slots, so that the ring wraps around.
+    for (int step = 1; step <= 2*numSlot+1; ++step) {
+        model.step();
+        producer.publish(step*double(TEST_TIME_STEP), step);
+    }
+    if (!consumer.readLatest(snapshot)) {
+        cout << "latest snapshot is not read" << endl;
+        ++numFailed;
+    } else {
+        numFailed += checkSnapshot(snapshot, model, decimation,
+                                   2*numSlot+1, 2*numSlot+1);
+    }
+    if (consumer.readLatest(snapshot)) {
+        cout << "snapshot is read again" << endl;
+        ++numFailed;
+    }
+    consumer.close();
+    producer.close();
+
+    if (numFailed > 0) {
+        REPORT_ERROR("State stream fails " << numFailed << " checks!");
+    }
+    cout << "state stream passes all checks" << endl;
+
+    return 0;
+}
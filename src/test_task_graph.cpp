@@ -0,0 +1,64 @@
+#include "test_common.h"
+
+using namespace barotropic_model;
+
+/**
+ *  Usage: test_task_graph
+ *
+ *  Check the task graph mode against the OpenMP stages on the toy test case
+ *  in the full and memory-lean modes. The tasks run the same row kernels in
+ *  an order that keeps the dependencies of the stages, and the energy is
+ *  summed by rows in the same order, so the states must be bit-identical
+ *  for any number of threads and band size.
+ */
+
+void
+runModel(bool leanMemory, int numTaskThread, int taskBandSize, int numStep,
+         vector<double> &state) {
+    BarotropicModel_A_ImplicitMidpoint model;
+    ToyTestCase testCase;
+    TimeManager timeManager;
+    model.setLeanMemory(leanMemory);
+    if (numTaskThread > 0) {
+        model.setTaskGraph(numTaskThread, taskBandSize);
+    }
+    initTestModel(model, timeManager, testCase, numStep);
+    model.step(numStep);
+    BarotropicModel::StateView view = model.state();
+    state.clear();
+    for (int j = 0; j < view.gd.numLat(); ++j) {
+        for (int i = 0; i < view.gd.numLon(); ++i) {
+            state.push_back(view.u(i, j));
+            state.push_back(view.v(i, j));
+            state.push_back(view.gd(i, j));
+        }
+    }
+} // runModel
+
+int main()
+{
+    const int numTaskThreads[] = {1, 3, 4};
+    const int taskBandSizes[] = {4, 1, 7};
+    int numFailed = 0;
+
+    for (int lean = 0; lean < 2; ++lean) {
+        vector<double> stages, tasks;
+        runModel(lean == 1, 0, 0, 20, stages);
+        for (int k = 0; k < 3; ++k) {
+            runModel(lean == 1, numTaskThreads[k], taskBandSizes[k], 20, tasks);
+            bool isIdentical = tasks == stages;
+            cout << (lean == 1 ? "lean" : "full") << " mode, " <<
+                numTaskThreads[k] << " threads, band " << taskBandSizes[k] <<
+                ": " << (isIdentical ? "identical" : "DIFFERENT") << endl;
+            if (!isIdentical) {
+                ++numFailed;
+            }
+        }
+    }
+    if (numFailed > 0) {
+        REPORT_ERROR("Task graph deviates from the OpenMP stages in " <<
+                     numFailed << " runs!");
+    }
+
+    return 0;
+}